@@ -0,0 +1,373 @@
+// Benchmarks for the CSV, aggregation, insert and LCD paths on synthetic day*.csv data at 1 Hz.
+// Links the same csv.c, stats.c, days.c, readings.c and lcd.c the programs use, with a mock I2C device
+// instead of wiringPi (add -DLCD_20X4 for the 20x4 driver):
+//   gcc -O2 -o bench bench.c csv.c stats.c days.c readings.c lcd.c metrics.c -lmysqlclient -lz -lm -lpthread
+//   ./bench [--days N] [--dir bench_data] [--out bench.json] [--db]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <mysql/mysql.h>
+#include "csv.h"
+#include "stats.h"
+#include "days.h"
+#include "readings.h"
+#include "lcd.h"
+
+#define ROWS_PER_DAY 86400     // 1 Hz
+#define INSERT_SINGLE 2000     // readings stored the way the collector does, three statements each
+#define BENCH_DB "projectdb_bench"  // scratch database, so the real histograms and cube are left alone
+#define LCD_FRAMES 20000
+#define I2C_WRITE_MS 0.2       // one wiringPiI2CWrite (address + data byte) at 100 kHz
+#define MAX_SIZES 5
+
+// dataset sizes timed: each of these below --days, then --days itself
+const int steps[] = {1, 7, 30, 365};
+
+// mock I2C device: counts bytes and the time the driver would spend in delay()
+long i2c_bytes;
+long delay_ms;
+
+int wiringPiI2CSetup(int addr)
+{
+    (void)addr;
+    return 0;
+}
+
+int wiringPiI2CWrite(int fd, int data)
+{
+    (void)fd;
+    (void)data;
+    i2c_bytes++;
+    return 0;
+}
+
+void delay(unsigned int ms)
+{
+    delay_ms += ms;
+}
+
+int bench_sizes(int days, int sizes[MAX_SIZES])
+{
+    int count = 0;
+    for (size_t i = 0; i < sizeof(steps) / sizeof(steps[0]) && steps[i] < days; i++)
+        sizes[count++] = steps[i];
+    sizes[count++] = days;
+    return count;
+}
+
+double seconds_since(const struct timespec *start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+void day_path(char *path, size_t size, const char *dir, int day)
+{
+    struct tm date = {0};
+    date.tm_year = 125;
+    date.tm_mday = 1 + day;
+    date.tm_hour = 12;
+    mktime(&date);
+    snprintf(path, size, "%s/day%02d%02d%02d.csv", dir, date.tm_mon + 1, date.tm_mday, date.tm_year - 100);
+}
+
+// daily and seasonal sine plus noise, DHT11 resolution (temperature tenths, whole humidity)
+void generate(const char *dir, int days)
+{
+    mkdir(dir, 0755);
+    char *buffer = malloc(IO_CHUNK);
+    srand(42);
+
+    for (int day = 0; day < days; day++) {
+        char path[300];
+        struct stat st;
+        day_path(path, sizeof(path), dir, day);
+        if (stat(path, &st) == 0)
+            continue;
+
+        FILE *out = fopen(path, "w");
+        if (out == NULL) {
+            perror(path);
+            exit(1);
+        }
+        setvbuf(out, buffer, _IOFBF, IO_CHUNK);
+
+        double season = 6.0 * sin(2 * M_PI * (day - 100) / 365.0);
+        for (int s = 0; s < ROWS_PER_DAY; s++) {
+            double temp = 21.0 + season + 4.0 * sin(2 * M_PI * (s - 9 * 3600) / 86400.0) + (rand() % 7 - 3) / 10.0;
+            int humi = (int)(50.0 - 1.5 * (temp - 21.0)) + rand() % 3 - 1;
+            fprintf(out, "\"%02d:%02d:%02d\",\"%.1f\",\"%d\",\"1\"\n", s / 3600, s / 60 % 60, s % 60, temp, humi);
+        }
+        fclose(out);
+    }
+    free(buffer);
+}
+
+// row callback doing what import validation does, minus the SQL
+int parse_row(char *fields[], void *ctx)
+{
+    double *sink = ctx;
+    *sink += strtod(fields[1], NULL) + strtod(fields[2], NULL);
+    return 0;
+}
+
+void bench_csv(FILE *json, const char *dir, const int sizes[], int count)
+{
+    fprintf(json, "  \"csv_parse\": [");
+    int first = 1;
+    for (int i = 0; i < count; i++) {
+        struct timespec start;
+        long bytes = 0, skipped = 0;
+        double sink = 0.0;
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int day = 0; day < sizes[i]; day++) {
+            char path[300];
+            day_path(path, sizeof(path), dir, day);
+            FILE *in = fopen(path, "r");
+            csvForEachLine(in, parse_row, &sink, &skipped);
+            bytes += ftell(in);
+            fclose(in);
+        }
+        double took = seconds_since(&start);
+        long rows = (long)sizes[i] * ROWS_PER_DAY;
+
+        fprintf(json, "%s\n    {\"days\": %d, \"rows\": %ld, \"seconds\": %.4f, \"rows_per_sec\": %.0f, \"mb_per_sec\": %.1f}",
+            first ? "" : ",", sizes[i], rows, took, rows / took, bytes / took / 1e6);
+        printf("csv parse    %4d days  %10ld rows  %8.3fs  %12.0f rows/s  %7.1f MB/s\n",
+            sizes[i], rows, took, rows / took, bytes / took / 1e6);
+        first = 0;
+    }
+    fprintf(json, "\n  ],\n");
+}
+
+int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// a generated day through the reader the query program uses for archived days
+void open_day(const char *dir, int day, struct daySource *src)
+{
+    char path[300];
+    day_path(path, sizeof(path), dir, day);
+    if (openDayFile(path, src)) {
+        perror(path);
+        exit(1);
+    }
+}
+
+// report fold (nextRow + per-day + per-hour stats) over every day file, and percentile from a histogram against sorting
+void bench_aggregate(FILE *json, const char *dir, const int sizes[], int count)
+{
+    struct daySource src;
+    char **row;
+
+    fprintf(json, "  \"aggregate\": [");
+    int first = 1;
+    for (int i = 0; i < count; i++) {
+        static struct periodStats hours[24];
+        struct timespec start;
+        long total = 0;
+        memset(hours, 0, sizeof(hours));
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        for (int day = 0; day < sizes[i]; day++) {
+            struct periodStats stats = {0};
+            open_day(dir, day, &src);
+            while ((row = nextRow(&src)) != NULL) {
+                double temp = atof(row[1]);
+                double humi = atof(row[2]);
+                double seconds = rowSeconds(&src, row);
+                int minute = minutesOf(row[0]);
+                addPeriod(&stats, temp, humi, seconds, row[0]);
+                if (minute >= 0)
+                    addPeriod(&hours[minute / 60], temp, humi, seconds, row[0]);
+            }
+            total += src.rows;
+            closeDay(&src);
+        }
+        double took = seconds_since(&start);
+
+        fprintf(json, "%s\n    {\"days\": %d, \"rows\": %ld, \"seconds\": %.4f, \"rows_per_sec\": %.0f}",
+            first ? "" : ",", sizes[i], total, took, total / took);
+        printf("aggregate    %4d days  %10ld rows  %8.3fs  %12.0f rows/s\n", sizes[i], total, took, total / took);
+        first = 0;
+    }
+    fprintf(json, "\n  ],\n");
+
+    // median of one day: histogram walk against sorting every reading
+    static struct histogram hist;
+    double *values = malloc(ROWS_PER_DAY * sizeof(double));
+    long rows = 0;
+    open_day(dir, 0, &src);
+    while ((row = nextRow(&src)) != NULL && rows < ROWS_PER_DAY) {
+        values[rows] = atof(row[1]);
+        int bin = (int)(values[rows] * 10 + 0.5);
+        hist.count[bin < 0 ? 0 : bin >= HIST_BINS ? HIST_BINS - 1 : bin]++;
+        hist.total++;
+        rows++;
+    }
+    closeDay(&src);
+
+    struct timespec start;
+    int repeats = 1000;
+    volatile double median = 0.0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int n = 0; n < repeats; n++)
+        median = histogramPercentile(&hist, 50.0);
+    double histogram_us = seconds_since(&start) / repeats * 1e6;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    qsort(values, rows, sizeof(double), compare_doubles);
+    double sorted = values[(rows - 1) / 2];
+    double sort_us = seconds_since(&start) * 1e6;
+
+    fprintf(json, "  \"median_one_day\": {\"rows\": %ld, \"histogram_us\": %.2f, \"sort_us\": %.0f, "
+        "\"histogram_median\": %.1f, \"sort_median\": %.1f},\n", rows, histogram_us, sort_us, median, sorted);
+    printf("median       1 day histogram %.2f us, sort %.0f us (%.1f / %.1f)\n", histogram_us, sort_us, median, sorted);
+
+    free(values);
+}
+
+// the collector's per-reading statements against dataquery import's batched path, in a scratch database
+void bench_insert(FILE *json, const char *dir)
+{
+    MYSQL *conn = mysql_init(NULL);
+    if (!mysql_real_connect(conn, "localhost", "taz", "raspberry", NULL, 0, NULL, 0) ||
+        mysql_query(conn, "create database if not exists " BENCH_DB) || mysql_select_db(conn, BENCH_DB) ||
+        reading_tables(conn) || day_table(conn, "bench_single") || day_table(conn, "bench_batched")) {
+        fprintf(stderr, "insert benchmark skipped: %s\n", mysql_error(conn));
+        fprintf(json, "  \"insert\": null,\n");
+        mysql_close(conn);
+        return;
+    }
+
+    // row, histogram and cube statements per reading, as datacollect stores them
+    struct timespec start;
+    struct tm when = {0};
+    when.tm_year = 125;
+    when.tm_mday = 1;
+    when.tm_wday = 3;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int r = 0; r < INSERT_SINGLE; r++) {
+        int val[5] = { 40 + r % 20, 0, 20 + r % 5, r % 10, 0 };
+        when.tm_hour = r / 3600;
+        when.tm_min = r / 60 % 60;
+        when.tm_sec = r % 60;
+        if (store_reading(conn, "bench_single", &when, val, 1)) {
+            fprintf(stderr, "%s\n", mysql_error(conn));
+            break;
+        }
+    }
+    double single = INSERT_SINGLE / seconds_since(&start);
+
+    // day 0's file through import's parser, validation and IMPORT_BATCH row statements
+    char path[300];
+    long skipped = 0;
+    day_path(path, sizeof(path), dir, 0);
+    FILE *in = fopen(path, "r");
+    struct importBatch batch = { conn, NULL, IMPORT_BATCH * IMPORT_ROW_MAX + 100, 0, 0, 0, 0, 0 };
+    batch.sql = malloc(batch.size);
+    batch.prefix = batch.len = snprintf(batch.sql, batch.size, "insert into bench_batched values ");
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (csvForEachLine(in, importRow, &batch, &skipped) == 0)
+        flushBatch(conn, batch.sql, &batch.len, batch.prefix, &batch.rows);
+    double batched = batch.total / seconds_since(&start);
+    fclose(in);
+    free(batch.sql);
+
+    mysql_query(conn, "drop database " BENCH_DB);
+    mysql_close(conn);
+
+    fprintf(json, "  \"insert\": {\"single_rows_per_sec\": %.0f, \"statements_per_single_row\": 3, "
+        "\"batched_rows_per_sec\": %.0f, \"batch\": %d, \"batched_rows\": %ld},\n",
+        single, batched, IMPORT_BATCH, batch.total);
+    printf("insert       per-row %.0f rows/s (3 statements each), batched import %.0f rows/s\n", single, batched);
+}
+
+// a full frame as the query results are shown: clear + every row written edge to edge
+void bench_lcd(FILE *json)
+{
+    const char *lines[] = { "T: 22.1C (13:05)    ", "H: 48.0% (09:12)    ", "day042325 14:05     ", "2016 readings       " };
+    struct timespec start;
+
+    i2c_bytes = 0;
+    delay_ms = 0;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (int f = 0; f < LCD_FRAMES; f++) {
+        lcd_clear();
+        for (int row = 0; row < LCD_ROWS; row++)
+            lcd_write(0, row, lines[row]);
+    }
+    double took = seconds_since(&start);
+
+    double bytes = (double)i2c_bytes / LCD_FRAMES;
+    double frame_ms = (double)delay_ms / LCD_FRAMES + bytes * I2C_WRITE_MS;
+    fprintf(json, "  \"lcd\": {\"geometry\": \"%dx%d\", \"frames\": %d, \"bytes_per_frame\": %.1f, \"cpu_frames_per_sec\": %.0f, "
+        "\"delay_ms_per_frame\": %.1f, \"modeled_frames_per_sec\": %.2f, \"modeled_bytes_per_sec\": %.0f}\n",
+        LCD_COLS, LCD_ROWS, LCD_FRAMES, bytes, LCD_FRAMES / took, (double)delay_ms / LCD_FRAMES, 1000.0 / frame_ms, bytes * 1000.0 / frame_ms);
+    printf("lcd %dx%d    %.1f bytes/frame, %.0f frames/s driver CPU, modeled %.2f frames/s (%.0f bytes/s) on the bus\n",
+        LCD_COLS, LCD_ROWS, bytes, LCD_FRAMES / took, 1000.0 / frame_ms, bytes * 1000.0 / frame_ms);
+}
+
+int main(int argc, char *argv[])
+{
+    int days = 30;
+    int db = 0;
+    const char *dir = "bench_data";
+    const char *out = "bench.json";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--days") == 0 && i + 1 < argc)
+            days = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+            dir = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc)
+            out = argv[++i];
+        else if (strcmp(argv[i], "--db") == 0)
+            db = 1;
+        else {
+            fprintf(stderr, "usage: %s [--days N] [--dir bench_data] [--out bench.json] [--db]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (days < 1)
+        days = 1;
+    int sizes[MAX_SIZES];
+    int count = bench_sizes(days, sizes);
+
+    FILE *json = fopen(out, "w");
+    if (json == NULL) {
+        perror(out);
+        return 1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    generate(dir, days);
+    printf("dataset      %d days at 1 Hz in %s/ (%.1fs to generate missing days)\n", days, dir, seconds_since(&start));
+
+    time_t now = time(NULL);
+    char stamp[40];
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    fprintf(json, "{\n  \"timestamp\": \"%s\",\n  \"days\": %d,\n", stamp, days);
+
+    bench_csv(json, dir, sizes, count);
+    bench_aggregate(json, dir, sizes, count);
+    if (db)
+        bench_insert(json, dir);
+    else
+        fprintf(json, "  \"insert\": null,\n");
+    bench_lcd(json);
+
+    fprintf(json, "}\n");
+    fclose(json);
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include <stdlib.h>
+#include <string.h>
+#include "csv.h"
+
+// split one CSV line of "time","temperature","humidity" in place, quotes optional
+int parseCsvLine(char *line, char *fields[], int max){
+    int n = 0;
+    char *p = line;
+    while (n < max){
+        if (*p == '"'){
+            fields[n++] = ++p;
+            while (*p && *p != '"')
+                p++;
+            if (*p)
+                *p++ = '\0';
+        }
+        else {
+            fields[n++] = p;
+            while (*p && *p != ',')
+                p++;
+        }
+        if (*p != ',')
+            break;
+        *p++ = '\0';
+    }
+    return n;
+}
+
+// chunked line splitter shared by import and the benchmarks
+int csvForEachLine(FILE *in, int (*row)(char *fields[], void *ctx), void *ctx, long *skipped){
+
+    char *chunk = malloc(IO_CHUNK + 1);
+    int status = 0;
+
+    // carry is the length of a partial line left over from the previous chunk
+    size_t carry = 0;
+    int eof = 0;
+    while (status == 0 && !eof){
+
+        size_t got = fread(chunk + carry, 1, IO_CHUNK - carry, in);
+        size_t end = carry + got;
+        if (got == 0){
+            eof = 1;
+            if (carry == 0)
+                break;
+            chunk[end++] = '\n';                                      // terminate a final unterminated line
+        }
+
+        size_t lineStart = 0;
+        for (size_t i = 0; i < end && status == 0; i++){
+            if (chunk[i] != '\n')
+                continue;
+
+            chunk[i] = '\0';
+            if (i > lineStart && chunk[i-1] == '\r')
+                chunk[i-1] = '\0';
+
+            char *fields[4];
+            char *line = chunk + lineStart;
+            lineStart = i + 1;
+            if (*line == '\0')
+                continue;
+
+            int n = parseCsvLine(line, fields, 4);
+            if (n < 3)
+                (*skipped)++;
+            else {
+                if (n == 3)
+                    fields[3] = NULL;
+                status = row(fields, ctx);
+            }
+        }
+
+        // move partial last line to the front for the next read
+        carry = end - lineStart;
+        if (status == 0 && carry == IO_CHUNK)
+            status = -1;
+        memmove(chunk, chunk + lineStart, carry);
+    }
+
+    free(chunk);
+    return status;
+
+}
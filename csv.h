@@ -0,0 +1,17 @@
+#ifndef CSV_H
+#define CSV_H
+
+#include <stdio.h>
+
+#define IO_CHUNK (1 << 20)      // bytes read per fread / output buffer size for CSV import + export
+
+// split one CSV line of "time","temperature","humidity"[,"seconds"] in place, quotes optional; returns fields found
+int parseCsvLine(char *line, char *fields[], int max);
+
+// stream a day*.csv file in IO_CHUNK reads and call row() with the four fields of every line, fields[3]
+// NULL on lines from before the interval was recorded; lines with fewer than three fields are counted
+// in *skipped. Returns 0, -1 on a line longer than
+// IO_CHUNK, or the first non-zero value row() returned (which stops the scan)
+int csvForEachLine(FILE *in, int (*row)(char *fields[], void *ctx), void *ctx, long *skipped);
+
+#endif
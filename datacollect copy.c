@@ -5,209 +5,197 @@
 #include <stdint.h>       // integer types
 #include <time.h>
 #include <string.h>
+#include <pthread.h>
+#include "dht11.h"        // sensor read + real-time sampling setup
+#include "metrics.h"      // counters + latency histograms, off unless METRICS_PORT/METRICS_FILE is set
+#include "readings.h"     // day tables, histograms and cube statements, shared with bench.c
+#include "lcd.h"          // shared panel driver
 
-#define MAX_TIME 85       // maximum time to wait for sensor response
-#define DHT11PIN 7        // GPIO pin number where DHT11 is connected
+#define INTERVAL 30000    // starting milliseconds between reads, then adapted between PACE_MIN and PACE_MAX
+#define RT_STATS_EVERY 20 // print sampling stats every this many reads in real-time mode
 
 int dht11_val[5] = {0, 0, 0, 0, 0}; // array to store sensor data
-int LCDAddr = 0x27;                 // LCD info
-int BLEN = 1;
-int fd;
-
-// LCD panel functions
-void write_word(int data){
-    int temp = data;
-    if (BLEN == 1)
-        temp |= 0x08;
-    else
-        temp &= 0xF7;
-    wiringPiI2CWrite(fd, temp);
-}
-
-void send_command(int comm){
-    int buf;
-    buf = comm & 0xF0;
-    buf |= 0x04;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-
-    buf = (comm & 0x0F) << 4;
-    buf |= 0x04;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-}
-
-void send_data(int data){
-    int buf;
-    buf = data & 0xF0;
-    buf |= 0x05;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-
-    buf = (data & 0x0F) << 4;
-    buf |= 0x05;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-}
-
-void init(){
-    send_command(0x33);
-    delay(5);
-    send_command(0x32);
-    delay(5);
-    send_command(0x28);
-    delay(5);
-    send_command(0x0C);
-    delay(5);
-    send_command(0x01);
-    wiringPiI2CWrite(fd, 0x08);
-}
-
-// reset LCD display
-void clear(){
-    send_command(0x01);
-}
 
-// move cursor on LCD
-void write(int x, int y, char data[]){
-    int addr, i;
-    int tmp;
-    if (x < 0)  x = 0;
-    if (x > 15) x = 15;
-    if (y < 0)  y = 0;
-    if (y > 1)  y = 1;
-
-    addr = 0x80 + 0x40 * y + x;
-    send_command(addr);
-
-    tmp = strlen(data);
-    for (i = 0; i < tmp; i++){
-        send_data(data[i]);
-    }
-}
-
-// read values from the DHT11 sensor
-void dht11_read_val(MYSQL *conn)
+// write a checked reading to the database and LCD. taken is when it was read (CLOCK_MONOTONIC), planned the
+// seconds until the next read, which only the first stored reading uses
+void dht11_store(MYSQL *conn, const struct timespec *taken, int planned)
 {
-    uint8_t lststate = HIGH;
-    uint8_t counter = 0;
-    uint8_t j = 0, i;
+    char strTemp[10];
+    sprintf(strTemp, "%d.%d", dht11_val[2], dht11_val[3]); // grab string temperature
 
-    // initialize the data array
-    for(i = 0; i < 5; i++)
-        dht11_val[i] = 0;
+    char strHumi[10];
+    sprintf(strHumi, "%d.%d", dht11_val[0], dht11_val[1]); // grab string humidity
 
-    // send start signal to the DHT11 sensor
-    pinMode(DHT11PIN, OUTPUT);
-    digitalWrite(DHT11PIN, LOW);
-    delay(18);
-    digitalWrite(DHT11PIN, HIGH);
-    delayMicroseconds(40);
+    time_t now = time(NULL);
+    struct tm *cur_time = localtime(&now);
+    char strTime[10];
+    sprintf(strTime, "%02d:%02d:%02d", cur_time->tm_hour, cur_time->tm_min, cur_time->tm_sec); // grab string time
 
-    pinMode(DHT11PIN, INPUT);
+    char table[40];                                                  // fits any int fields, not just real dates
+    snprintf(table, sizeof(table), "day%02d%d%d", cur_time->tm_mon+1, cur_time->tm_mday, cur_time->tm_year-100);
 
-    for(i = 0; i < MAX_TIME; i++)
+    // a new table at startup and after midnight
+    static char current[40];
+    if (strcmp(table, current) != 0)
     {
-        counter = 0;
-        while(digitalRead(DHT11PIN) == lststate) {
-            counter++;
-            delayMicroseconds(1);
-            if(counter == 255)
-                break;
-        }
-
-        lststate = digitalRead(DHT11PIN);
-
-        if(counter == 255)
-            break;
-
-        if((i >= 4) && (i % 2 == 0)) {
-            dht11_val[j / 8] <<= 1;
-            if(counter > 14)  // determining signal
-                dht11_val[j / 8] |= 1;
-            j++;
+        if (day_table(conn, table))
+        {
+            lcd_clear();
+            lcd_write(0, 0, "Error, exiting");
+            exit(1);
         }
+        strcpy(current, table);
     }
 
-    // verify checksum to ensure data integrity
-    if((j >= 40) && (dht11_val[4] == ((dht11_val[0] + dht11_val[1] + dht11_val[2] + dht11_val[3]) & 0xFF)))
-    {
-
-        char strTemp[10];
-        sprintf(strTemp, "%d.%d", dht11_val[2], dht11_val[3]); // grab string temperature
-
-        char strHumi[10];
-        sprintf(strHumi, "%d.%d", dht11_val[0], dht11_val[1]); // grab string humidity
-
-        time_t now = time(NULL);
-        struct tm *cur_time = localtime(&now);
-        char strTime[10];
-        sprintf(strTime, "%02d:%02d", cur_time->tm_hour, cur_time->tm_min); // grab string time
-
-        char insert[100];
-        sprintf(insert, "insert into day%02d%d%d values ('%s', %s, %s)",
-        cur_time->tm_mon+1, cur_time->tm_mday, cur_time->tm_year-100, strTime, strTemp, strHumi);
-
-
-        if ((dht11_val[0] != 0) && (dht11_val[2]!= 0)){ // prevent data containing zeroes from entering database
+    if ((dht11_val[0] != 0) && (dht11_val[2]!= 0)){ // prevent data containing zeroes from entering database
+
+        // a row stands for the time since the previous stored one, so failed reads, readings filtered
+        // here and readings the sampler replaced before they were stored still count towards it
+        static struct timespec last;
+        static int stored;
+        int seconds = planned;
+        if (stored)
+        {
+            double elapsed = (taken->tv_sec - last.tv_sec) + (taken->tv_nsec - last.tv_nsec) / 1e9;
+            seconds = elapsed < 1.0 ? 1 : (int)(elapsed + 0.5);
+        }
 
-            if (mysql_query(conn, insert))
-            {
-                clear();
-                write(0,0, "Error, exiting");
-                exit(1);
-            }
+        uint64_t started = metrics_now();
+        if (store_reading(conn, table, cur_time, dht11_val, seconds))
+        {
+            lcd_clear();
+            lcd_write(0,0, "Error, exiting");
+            exit(1);
         }
+        metrics_observe(HIST_INSERT, started);
+        metrics_count(COUNT_INSERTS, 1);
+        last = *taken;
+        stored = 1;
+    }
 
-        // print to LCD for double checking on what is being entered into table
-        clear();
-        write(0, 0, "Temp: ");
-        write(5, 0, strTemp);
-        write(0, 1, "Humi: ");
-        write(5, 1, strHumi);
+    // print to LCD for double checking on what is being entered into table
+    lcd_clear();
+    lcd_write(0, 0, "Temp: ");
+    lcd_write(5, 0, strTemp);
+    lcd_write(0, 1, "Humi: ");
+    lcd_write(5, 1, strHumi);
+#if LCD_ROWS >= 4
+    lcd_write(0, 2, "Time: ");
+    lcd_write(5, 2, strTime);
+    lcd_write(0, 3, table);
+#endif
+}
 
-    }
+// read values from the DHT11 sensor & write to database, returns milliseconds until the next read
+int dht11_read_val(MYSQL *conn, struct dht11_pace *pace)
+{
+    struct timespec taken;
+    clock_gettime(CLOCK_MONOTONIC, &taken);
+    uint64_t started = metrics_now();
+    int ok = dht11_read_raw(dht11_val);
+    metrics_observe(HIST_SENSOR_READ, started);
+    metrics_count(COUNT_SENSOR_READS, 1);
+    metrics_count(COUNT_CHECKSUM_FAILURES, !ok);
+
+    int interval = dht11_pace_next(pace, dht11_val, ok);
+    if (ok)
+        dht11_store(conn, &taken, interval / 1000);
 
     // print an error if checksum fails
     else
     {
-        clear();
-        write(0, 0, "Invalid Data!");
+        lcd_clear();
+        lcd_write(0, 0, "Invalid Data!");
     }
+    return interval;
 }
 
-// scrolling text on LCD, for longer messages to fit
-void scrollText(const char *message){
-    char buffer[17] = {0};                                           // 16 spaces for LCD screen width
-    char padded[300] = {0};
-    snprintf(padded, sizeof(padded), "%16s%s%16s", "", message, ""); // padding allows for the scroll
+// latest reading handed from the sampling thread to the main thread
+struct mailbox {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    int val[5];
+    int ok;
+    struct timespec taken; // when the sampler read it
+    int planned;          // seconds until the sampler's next read
+    int fresh;
+    int rt_error;
+    struct dht11_stats stats;
+};
+
+struct mailbox box = { .lock = PTHREAD_MUTEX_INITIALIZER, .ready = PTHREAD_COND_INITIALIZER };
+int rt_core = RT_CORE;
+
+// move an absolute deadline on by ms; if storing already overran it, the next read is now instead of a burst of catch-up reads
+void next_deadline(struct timespec *next, int ms)
+{
+    next->tv_sec += ms / 1000;
+    next->tv_nsec += (ms % 1000) * 1000000L;
+    if (next->tv_nsec >= 1000000000L) {
+        next->tv_sec++;
+        next->tv_nsec -= 1000000000L;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (next->tv_sec < now.tv_sec || (next->tv_sec == now.tv_sec && next->tv_nsec < now.tv_nsec))
+        *next = now;
+}
+
+// real-time sampling thread, only reads the sensor so MySQL and LCD I/O can't preempt the bit loop
+void *sampling_thread(void *arg)
+{
+    (void)arg;
+    int val[5];
+    struct dht11_stats stats = {0};
+    struct dht11_pace pace;
+    struct timespec next;
+
+    dht11_pace_init(&pace, INTERVAL);
 
-    int length = strlen(padded);
-    for (int i = 0; i <= length - 16; i++){                          // moves characters left one at a time, starting at first 16
-        strncpy(buffer, &padded[i], 16);
-        buffer[16] = '\0';
+    int err = dht11_realtime(rt_core);
+    pthread_mutex_lock(&box.lock);
+    box.rt_error = err;
+    pthread_mutex_unlock(&box.lock);
 
-        clear();
-        write(0,0, buffer);
-        delay(230);                                                  // scroll speed
+    // absolute deadlines so time spent reading doesn't drift the interval
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (1)
+    {
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        uint64_t started = metrics_now();
+        int ok = dht11_sample(val, &stats, &next);
+        metrics_observe(HIST_SENSOR_READ, started);
+        metrics_count(COUNT_SENSOR_READS, 1);
+        metrics_count(COUNT_CHECKSUM_FAILURES, !ok);
+        int interval = dht11_pace_next(&pace, val, ok);
+
+        pthread_mutex_lock(&box.lock);
+        memcpy(box.val, val, sizeof(box.val));
+        box.ok = ok;
+        box.taken = next;
+        box.planned = interval / 1000;
+        box.stats = stats;
+        box.fresh = 1;
+        pthread_cond_signal(&box.ready);
+        pthread_mutex_unlock(&box.lock);
+
+        next_deadline(&next, interval);
     }
+    return NULL;
 }
 
-int main()
+int main(int argc, char *argv[])
 {
+    // datacollect --rt [core] reads the sensor from a SCHED_FIFO thread pinned to core
+    int realtime = argc >= 2 && strcmp(argv[1], "--rt") == 0;
+    if (realtime && argc >= 3)
+        rt_core = atoi(argv[2]);
 
     // LCD panel setup
-    fd = wiringPiI2CSetup(LCDAddr);
-    init();
+    lcd_init();
     srand(time(NULL));
+    metrics_start("datacollect");
 
     // initialize WiringPi library for GPIO control, if initialization fails, exit the program
     if (wiringPiSetup() == -1)
@@ -227,8 +215,8 @@ int main()
     // connect to database
     if (!mysql_real_connect(conn, server, user, password, database, 0, NULL, 0))
     {
-        clear();
-        write(0, 0, "Error, exiting");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exiting");
         exit(1);
     }
 
@@ -236,8 +224,8 @@ int main()
     if (mysql_query(conn, "show tables"))
     {
         fprintf(stderr, "%s\n", mysql_error(conn));
-        clear();
-        write(0, 0, "Error, exiting");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exiting");
         exit(1);
     }
     res = mysql_use_result(conn);
@@ -245,30 +233,74 @@ int main()
     // go through tables
     while ((row = mysql_fetch_row(res)) != NULL){}
 
-    // create new table if new day
-    scrollText("Now collecting data:");
-    time_t now = time(NULL);
-    struct tm *cur_time = localtime(&now);
-    char newtable[100];
-    sprintf(newtable, "create table if not exists day%02d%d%d (time varchar(50), temperature float, humidity float)",
-        cur_time->tm_mon+1, cur_time->tm_mday, cur_time->tm_year-100);
-
-    if (mysql_query(conn, newtable))
+    lcd_scroll("Now collecting data:", 230);
+    // per day/hour histograms and the month x day-of-week x hour cube, shared by all days
+    if (reading_tables(conn))
     {
-        clear();
-        write(0, 0, "Error, exiting");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exiting");
         exit(1);
     }
 
+    // real-time mode: sampling thread reads, this thread stores and displays
+    if (realtime)
+    {
+        pthread_t sampler;
+        if (pthread_create(&sampler, NULL, sampling_thread, NULL))
+        {
+            lcd_clear();
+            lcd_write(0, 0, "Error, exiting");
+            exit(1);
+        }
+
+        int first = 1;
+        while (1)
+        {
+            pthread_mutex_lock(&box.lock);
+            while (!box.fresh)
+                pthread_cond_wait(&box.ready, &box.lock);
+            box.fresh = 0;
+            int ok = box.ok;
+            struct timespec taken = box.taken;
+            int planned = box.planned;
+            memcpy(dht11_val, box.val, sizeof(dht11_val));
+            struct dht11_stats stats = box.stats;
+            int err = box.rt_error;
+            pthread_mutex_unlock(&box.lock);
+
+            if (ok)
+                dht11_store(conn, &taken, planned);
+            else
+            {
+                lcd_clear();
+                lcd_write(0, 0, "Invalid Data!");
+            }
+
+            // the sampler sets rt_error before its first read, so it is known after the first wait
+            if (first && err)
+                fprintf(stderr, "real-time setup failed (%s), sampling without it\n", strerror(err));
+            first = 0;
+            if (stats.reads % RT_STATS_EVERY == 0)
+                printf("reads %ld, failures %ld (%.1f%%), jitter avg %ldus max %ldus, longest read %ldus\n",
+                    stats.reads, stats.failures, 100.0 * stats.failures / stats.reads,
+                    stats.jitter_sum / stats.reads, stats.jitter_max, stats.read_max);
+        }
+    }
 
-    // continuous loop to read sensor data at intervals
+    // continuous loop to read sensor data, faster while readings change and backing off while they're flat
+    // absolute deadlines, so storing and the LCD don't add to the interval
+    struct dht11_pace pace;
+    struct timespec next;
+    dht11_pace_init(&pace, INTERVAL);
+    clock_gettime(CLOCK_MONOTONIC, &next);
     while (1)
     {
         // call the function to read values from the DHT11 sensor & write to database
-        dht11_read_val(conn);
+        int interval = dht11_read_val(conn, &pace);
 
         // measured in milliseconds, 3000 for 3 seconds, 300000 for five minutes
-        delay(30000);
+        next_deadline(&next, interval);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
     }
 
     // close connection
@@ -3,8 +3,15 @@
 #include <mysql/mysql.h>
 #include <string.h>
 #include <time.h>
-#include <wiringPi.h>
-#include <wiringPiI2C.h>
+#include <zlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "metrics.h"
+#include "csv.h"
+#include "stats.h"
+#include "lcd.h"
+#include "days.h"
+#include "readings.h"
 
 // function prototypes
 void average(MYSQL *conn);
@@ -12,116 +19,75 @@ void maximum(MYSQL *conn);
 void minimum(MYSQL *conn);
 void hottest(MYSQL *conn);
 void coldest(MYSQL *conn);
+void median(MYSQL *conn);
+void percentile(MYSQL *conn);
+void distribution(MYSQL *conn);
+int importCsv(MYSQL *conn, const char *path);
+int exportCsv(MYSQL *conn, const char *table, const char *path);
+int exportAll(MYSQL *conn);
+int report(MYSQL *conn, const char *path);
+int foldDay(MYSQL *conn, const char *table);
+int rebuild(MYSQL *conn);
+int foldArchived(MYSQL *conn, const char *day);
+void hourly(MYSQL *conn);
+void weekend(MYSQL *conn);
+void monthly(MYSQL *conn);
+double elapsedSince(const struct timespec *start);
 void scrollText(const char *message);
 void customChar(void);
 
-int LCDAddr = 0x27;
-int BLEN = 1;
-int fd;
-
-// LCD panel functions
-void write_word(int data){
-    int temp = data;
-    if (BLEN == 1)
-        temp |= 0x08;
-    else
-        temp &= 0xF7;
-    wiringPiI2CWrite(fd, temp);
-}
-
-void send_command(int comm){
-    int buf;
-    buf = comm & 0xF0;
-    buf |= 0x04;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-
-    buf = (comm & 0x0F) << 4;
-    buf |= 0x04;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-}
-
-void send_data(int data){
-    int buf;
-    buf = data & 0xF0;
-    buf |= 0x05;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-
-    buf = (data & 0x0F) << 4;
-    buf |= 0x05;
-    write_word(buf);
-    delay(2);
-    buf &= 0xFB;
-    write_word(buf);
-}
-
-void init(){
-    send_command(0x33);
-    delay(5);
-    send_command(0x32);
-    delay(5);
-    send_command(0x28);
-    delay(5);
-    send_command(0x0C);
-    delay(5);
-    send_command(0x01);
-    wiringPiI2CWrite(fd, 0x08);
-}
-
-// reset LCD display
-void clear(){
-    send_command(0x01);
-}
-
-// move cursor on LCD
-void write(int x, int y, char data[]){
-    int addr, i;
-    int tmp;
-    if (x < 0)  x = 0;
-    if (x > 15) x = 15;
-    if (y < 0)  y = 0;
-    if (y > 1)  y = 1;
-
-    addr = 0x80 + 0x40 * y + x;
-    send_command(addr);
-
-    tmp = strlen(data);
-    for (i = 0; i < tmp; i++){
-        send_data(data[i]);
-    }
-}
+int readInt(int *value);
+int readDouble(double *value);
+void loadHistogram(MYSQL *conn, const char *day, int hour, char channel, struct histogram *hist);
+void chooseHistograms(MYSQL *conn, const char *prompt, struct histogram *temp, struct histogram *humi);
 
-// scrolling text on LCD, for longer messages to fit
-void scrollText(const char *message){
-    char buffer[17] = {0};                                           // 16 spaces for LCD screen width
-    char padded[300] = {0};
-    snprintf(padded, sizeof(padded), "%16s%s%16s", "", message, ""); // padding allows for the scroll
+#define REPORT_TEMP_ABOVE 25.0  // report counts time spent above these thresholds
+#define REPORT_HUMI_ABOVE 60.0
+#define REPORT_MAX_GAP 30       // minutes, longer gaps between readings are treated as the sensor being off
 
-    int length = strlen(padded);
-    for (int i = 0; i <= length - 16; i++){                          // moves characters left one at a time, starting at first 16
-        strncpy(buffer, &padded[i], 16);
-        buffer[16] = '\0';
+int cubeSummary(MYSQL *conn, const char *where, struct periodStats *stats);
+void showSummary(const char *label, const struct periodStats *stats);
 
-        clear();
-        write(0,0, buffer);
-        delay(160);                                                  // scroll speed
-    }
+#define ARCHIVE_AFTER 30        // default age in days before a day table is compacted
+
+// readings carry HH:MM:SS, a 16 column row only has room for HH:MM after the value
+#if LCD_COLS >= 20
+#define TIME_SHOWN 8
+#else
+#define TIME_SHOWN 5
+#endif
+
+#define MENU_ITEMS 12
+const char *menu[MENU_ITEMS] = {
+    "1. AVERAGE", "2. MINIMUM", "3. MAXIMUM", "4. HOTTEST", "5. COLDEST", "6. EXIT",
+    "7. MEDIAN", "8. PERCENTILE", "9. DISTRIBUTION", "10. BY HOUR", "11. WEEKEND", "12. BY MONTH",
+};
+
+// one line of the archive index, extremes are kept so hottest/coldest never decompress
+struct archiveEntry {
+    char day[20];
+    long rows;
+    double minTemp;
+    char minTempTime[10];
+    double maxTemp;
+    char maxTempTime[10];
+};
+
+int readIndex(FILE *index, struct archiveEntry *entry);
+int isArchived(const char *day);
+void scrollArchived(void);
+int compactDay(MYSQL *conn, const char *table);
+int compact(MYSQL *conn, int days);
+
+// scrolling text on LCD, for longer messages to fit
+void scrollText(const char *message){
+    lcd_scroll(message, 160);                                        // scroll speed
 }
 
-int main(void)
+int main(int argc, char *argv[])
 {
-    // LCD panel setup
-    fd = wiringPiI2CSetup(LCDAddr);
-    init();
     srand(time(NULL));
+    metrics_start("dataquery");
 
     // MYSQL setup
     MYSQL *conn;
@@ -138,29 +104,65 @@ int main(void)
         exit(1);
     }
 
+    // bulk CSV subcommands, run without the menu:
+    //   dataquery import dayMMDDYY.csv [...]
+    //   dataquery export [dayMMDDYY [file.csv]]
+    //   dataquery report [file]
+    //   dataquery rebuild              (histograms + cube from every day table)
+    //   dataquery compact [days]       (archive days older than that, run from cron)
+    if (argc >= 2 && strcmp(argv[1], "import") == 0){
+        int status = 0;
+        for (int i = 2; i < argc; i++){
+            if (importCsv(conn, argv[i]))
+                status = 1;
+        }
+        mysql_close(conn);
+        return status;
+    }
+    if (argc >= 2 && strcmp(argv[1], "compact") == 0){
+        int status = compact(conn, argc >= 3 ? atoi(argv[2]) : ARCHIVE_AFTER);
+        mysql_close(conn);
+        return status;
+    }
+    if (argc >= 2 && strcmp(argv[1], "rebuild") == 0){
+        int status = rebuild(conn);
+        mysql_close(conn);
+        return status;
+    }
+    if (argc >= 2 && strcmp(argv[1], "report") == 0){
+        int status = report(conn, argc >= 3 ? argv[2] : NULL);
+        mysql_close(conn);
+        return status;
+    }
+    if (argc >= 2 && strcmp(argv[1], "export") == 0){
+        int status;
+        if (argc >= 3)
+            status = exportCsv(conn, argv[2], argc >= 4 ? argv[3] : NULL);
+        else
+            status = exportAll(conn);
+        mysql_close(conn);
+        return status;
+    }
+
+    // LCD panel setup, only for the menu: a subcommand from cron would reset the panel under the collector
+    lcd_init();
+
     // loop main menu until exit is chosen
     int choice = 0;
     while (choice != 6){
 
         scrollText("Choose from menu: ");
 
-        clear();
-        write(0, 0, "1. AVERAGE");
-        write(0, 1, "2. MINIMUM");
-        sleep(2);
-
-        clear();
-        write(0, 0, "3. MAXIMUM");
-        write(0, 1, "4. HOTTEST");
-        sleep(2);
-
-        clear();
-        write(0, 0, "5. COLDEST");
-        write(0, 1, "6. EXIT");
-        sleep(2);
+        // as many items per page as the panel has rows
+        for (int i = 0; i < MENU_ITEMS; i += LCD_ROWS){
+            lcd_clear();
+            for (int row = 0; row < LCD_ROWS && i + row < MENU_ITEMS; row++)
+                lcd_write(0, row, menu[i + row]);
+            sleep(2);
+        }
 
-        clear();
-        write(0, 0, "Your choice:");
+        lcd_clear();
+        lcd_write(0, 0, "Your choice:");
         scanf("%d", &choice);
 
         switch (choice){
@@ -180,8 +182,26 @@ int main(void)
                 coldest(conn);
                 break;
             case 6:
-                clear();
-                write(0, 0, "Exited program");
+                lcd_clear();
+                lcd_write(0, 0, "Exited program");
+                break;
+            case 7:
+                median(conn);
+                break;
+            case 8:
+                percentile(conn);
+                break;
+            case 9:
+                distribution(conn);
+                break;
+            case 10:
+                hourly(conn);
+                break;
+            case 11:
+                weekend(conn);
+                break;
+            case 12:
+                monthly(conn);
                 break;
             default:
                 scrollText("Input not recognized");
@@ -199,13 +219,14 @@ void average(MYSQL *conn) {
 
     MYSQL_RES *res;
     MYSQL_ROW row;
+    struct daySource src;
 
     // print out tables to choose from
     scrollText("Select day to find average from:");
-    if (mysql_query(conn, "show tables"))
+    if (mysql_query(conn, "show tables like 'day%'"))
     {
-        clear();
-        write(0, 0, "Error, exited");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
         exit(1);
     }
     res = mysql_store_result(conn);
@@ -215,40 +236,63 @@ void average(MYSQL *conn) {
         sprintf(day, "%s", row[0]);
         scrollText(day);
     }
+    mysql_free_result(res);
+    scrollArchived();
 
     // send query to collect specific date data + input validation
     char selection[50];
     while (1){
 
-        clear();
-        write(0, 0, "Choose a date:");
+        lcd_clear();
+        lcd_write(0, 0, "Choose a date:");
         scanf("%s", selection);
 
-        char query[100];
-        sprintf(query, "select * from %s", selection);
-
-        if (mysql_query(conn, query))
+        if (openDay(conn, selection, 0, &src))
         {
-            scrollText("Table doesn't exist, enter again");
+            scrollText("Day doesn't exist, enter again");
             continue;
         }
 
         break;
     }
-    res = mysql_store_result(conn);
 
-    // process the averages
+    // process the averages, weighted by how long each reading stands for
     double avgTemp = 0.0;
     double avgHumi = 0.0;
-    int count = 0;
-    while ((row = mysql_fetch_row(res)) != NULL){
-        avgTemp += atof(row[1]);
-        avgHumi += atof(row[2]);
-        count++;
+    double seconds = 0.0;
+
+    // an archived day has its hourly rollups in the database, no need to decompress it
+    if (src.gz != NULL){
+        char query[400];
+        sprintf(query, "select sum(tempAvg * coalesce(seconds, count * %d)), sum(humiAvg * coalesce(seconds, count * %d)), "
+            "sum(coalesce(seconds, count * %d)) from rollups where day = '%s'",
+            LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS, selection);
+        if (mysql_query(conn, query) == 0){
+            res = mysql_store_result(conn);
+            row = res != NULL ? mysql_fetch_row(res) : NULL;
+            if (row != NULL && row[2] != NULL){
+                avgTemp = atof(row[0]);
+                avgHumi = atof(row[1]);
+                seconds = atof(row[2]);
+            }
+            if (res != NULL)
+                mysql_free_result(res);
+        }
     }
 
-    avgTemp /= count;
-    avgHumi /= count;
+    // live days, and archived days from before rollups were kept
+    if (seconds <= 0){
+        while ((row = nextRow(&src)) != NULL){
+            double weight = rowSeconds(&src, row);
+            avgTemp += atof(row[1]) * weight;
+            avgHumi += atof(row[2]) * weight;
+            seconds += weight;
+        }
+    }
+    closeDay(&src);                             // scan time stops here, not after the display
+
+    avgTemp /= seconds;
+    avgHumi /= seconds;
 
     // print out result to LCD display
     char strHumi[20];
@@ -257,13 +301,12 @@ void average(MYSQL *conn) {
     char strTemp[20];
     sprintf(strTemp, "T: %0.1fC", avgTemp);
 
-    clear();
-    write(0, 0, strTemp);
-    write(0, 1, strHumi);
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
 
     // pause program before going back to menu
     sleep(3);
-    mysql_free_result(res);
 
 }
 
@@ -272,13 +315,14 @@ void minimum(MYSQL *conn) {
 
     MYSQL_RES *res;
     MYSQL_ROW row;
+    struct daySource src;
 
     // print out tables to choose from
     scrollText("Select day to find minimum from:");
-    if (mysql_query(conn, "show tables"))
+    if (mysql_query(conn, "show tables like 'day%'"))
     {
-        clear();
-        write(0, 0, "Error, exited");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
         exit(1);
     }
     res = mysql_store_result(conn);
@@ -288,34 +332,32 @@ void minimum(MYSQL *conn) {
         sprintf(day, "%s", row[0]);
         scrollText(day);
     }
+    mysql_free_result(res);
+    scrollArchived();
 
     // send query to collect specific date data + input validation
     char selection[50];
     while (1){
 
-        clear();
-        write(0, 0, "Choose a date:");
+        lcd_clear();
+        lcd_write(0, 0, "Choose a date:");
         scanf("%s", selection);
 
-        char query[100];
-        sprintf(query, "select * from %s", selection);
-
-        if (mysql_query(conn, query))
+        if (openDay(conn, selection, 0, &src))
         {
-            scrollText("Table doesn't exist, enter again");
+            scrollText("Day doesn't exist, enter again");
             continue;
         }
 
         break;
     }
-    res = mysql_store_result(conn);
 
     // find coldest temperature & lowest humidity
     double coldest = 400.0;                     // 400.0 *C since that's not a possible temperature/humidity
     double lowest = 400.0;                      // for day-to-day weather
-    char timeTemp[10];
-    char timeHumi[10];
-    while ((row = mysql_fetch_row(res)) != NULL){
+    char timeTemp[10] = "";
+    char timeHumi[10] = "";
+    while ((row = nextRow(&src)) != NULL){
         double temp = atof(row[1]);
         double humi = atof(row[2]);
         if (temp < coldest){
@@ -331,21 +373,21 @@ void minimum(MYSQL *conn) {
         }
 
     }
+    closeDay(&src);
 
     // print out result to LCD display
     char strHumi[50];
-    sprintf(strHumi, "H: %0.1f%% (%s)", lowest, timeHumi);
+    sprintf(strHumi, "H: %0.1f%% (%.*s)", lowest, TIME_SHOWN, timeHumi);
 
     char strTemp[50];
-    sprintf(strTemp, "T: %0.1fC (%s)", coldest, timeTemp);
+    sprintf(strTemp, "T: %0.1fC (%.*s)", coldest, TIME_SHOWN, timeTemp);
 
-    clear();
-    write(0, 0, strTemp);
-    write(0, 1, strHumi);
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
 
     // pause program before going back to menu
     sleep(3);
-    mysql_free_result(res);
 
 }
 
@@ -354,13 +396,14 @@ void maximum(MYSQL *conn) {
 
     MYSQL_RES *res;
     MYSQL_ROW row;
+    struct daySource src;
 
     // print out tables to choose from
     scrollText("Select a day to find the maximum from:");
-    if (mysql_query(conn, "show tables"))
+    if (mysql_query(conn, "show tables like 'day%'"))
     {
-        clear();
-        write(0, 0, "Error, exited");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
         exit(1);
     }
     res = mysql_store_result(conn);
@@ -370,34 +413,32 @@ void maximum(MYSQL *conn) {
         sprintf(day, "%s", row[0]);
         scrollText(day);
     }
+    mysql_free_result(res);
+    scrollArchived();
 
     // send query to collect specific date data + input validation
     char selection[50];
     while (1){
 
-        clear();
-        write(0, 0, "Choose a date:");
+        lcd_clear();
+        lcd_write(0, 0, "Choose a date:");
         scanf("%s", selection);
 
-        char query[100];
-        sprintf(query, "select * from %s", selection);
-
-        if (mysql_query(conn, query))
+        if (openDay(conn, selection, 0, &src))
         {
-            scrollText("Table doesn't exist, enter again");
+            scrollText("Day doesn't exist, enter again");
             continue;
         }
 
         break;
     }
-    res = mysql_store_result(conn);
 
     // find hottest temperature & highest humidity
     double hottest = 0.0;
     double highest = 0.0;
-    char timeTemp[10];
-    char timeHumi[10];
-    while ((row = mysql_fetch_row(res)) != NULL){
+    char timeTemp[10] = "";
+    char timeHumi[10] = "";
+    while ((row = nextRow(&src)) != NULL){
         double temp = atof(row[1]);
         double humi = atof(row[2]);
         if (temp > hottest){
@@ -413,21 +454,21 @@ void maximum(MYSQL *conn) {
         }
 
     }
+    closeDay(&src);
 
     // output results to LCD display
     char strHumi[50];
-    sprintf(strHumi, "H: %0.1f%% (%s)", highest, timeHumi);
+    sprintf(strHumi, "H: %0.1f%% (%.*s)", highest, TIME_SHOWN, timeHumi);
 
     char strTemp[50];
-    sprintf(strTemp, "T: %0.1fC (%s)", hottest, timeTemp);
+    sprintf(strTemp, "T: %0.1fC (%.*s)", hottest, TIME_SHOWN, timeTemp);
 
-    clear();
-    write(0, 0, strTemp);
-    write(0, 1, strHumi);
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
 
     // pause program before going back to menu
     sleep(3);
-    mysql_free_result(res);
 
 }
 
@@ -440,14 +481,14 @@ void hottest(MYSQL *conn) {
     MYSQL_ROW row;
 
     double estHottest = 0.0;
-    char estTime[10];
-    char day[20];
+    char estTime[10] = "";
+    char day[20] = "none";
 
     // query tables
-    if (mysql_query(conn, "show tables"))
+    if (mysql_query(conn, "show tables like 'day%'"))
     {
-        clear();
-        write(0, 0, "Error, exited");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
         exit(1);
     }
     resOuter = mysql_store_result(conn);
@@ -461,21 +502,24 @@ void hottest(MYSQL *conn) {
         ifDay[sizeof(ifDay)-1] = '\0';
 
         // query data from specific table
+        uint64_t started = metrics_now();
         char query[100];
         sprintf(query, "select * from %s", row[0]);
 
         if (mysql_query(conn, query)){
-            clear();
-            write(0, 0, "Error, exited");
+            lcd_clear();
+            lcd_write(0, 0, "Error, exited");
             exit(1);
         }
         resInner = mysql_store_result(conn);
 
         // sift through day's data and find hottest moment
         double hottest = 0.0;
-        char timeTemp[10];
+        char timeTemp[10] = "";
+        long rows = 0;
         while ((row = mysql_fetch_row(resInner)) != NULL){
             double temp = atof(row[1]);
+            rows++;
             if (temp > hottest){
                 hottest = temp;
                 strncpy(timeTemp, row[0], sizeof(timeTemp) - 1);
@@ -483,6 +527,9 @@ void hottest(MYSQL *conn) {
             }
 
         }
+        mysql_free_result(resInner);
+        metrics_observe(HIST_QUERY_SCAN, started);
+        metrics_count(COUNT_QUERY_ROWS, rows);
 
         // replace values if there is new hottest
         if (hottest > estHottest){
@@ -492,27 +539,50 @@ void hottest(MYSQL *conn) {
             estTime[sizeof(estTime)-1] = '\0';
 
             strncpy(day, ifDay, sizeof(day) - 1);
+            day[sizeof(day)-1] = '\0';
         }
 
     }
 
 
+    // archived days keep their extremes in the archive index, no need to decompress them
+    struct archiveEntry entry;
+    FILE *index = openIndex("r");
+    while (index != NULL && readIndex(index, &entry)){
+        if (entry.maxTemp > estHottest){
+            estHottest = entry.maxTemp;
+
+            strncpy(estTime, entry.maxTempTime, sizeof(estTime) - 1);
+            estTime[sizeof(estTime)-1] = '\0';
+
+            strncpy(day, entry.day, sizeof(day) - 1);
+            day[sizeof(day)-1] = '\0';
+        }
+    }
+    if (index != NULL)
+        fclose(index);
+
     // output results to LCD display
     char bottomLine[50];
-    sprintf(bottomLine, "%0.1fC (%s)", estHottest, estTime);
-
-    clear();
-    write(0, 0, "Hottest DB day: "); // DB - database, hottest day on database
-    write(0, 1, day);
+    sprintf(bottomLine, "%0.1fC (%.*s)", estHottest, TIME_SHOWN, estTime);
+
+    lcd_clear();
+    lcd_write(0, 0, "Hottest DB day: "); // DB - database, hottest day on database
+    lcd_write(0, 1, day);
+#if LCD_ROWS >= 4
+    lcd_write(0, 2, "At temperature: ");
+    lcd_write(0, 3, bottomLine);
+    sleep(6);
+#else
     sleep(3);
 
-    clear();
-    write(0, 0, "At temperature: ");
-    write(0, 1, bottomLine);
+    lcd_clear();
+    lcd_write(0, 0, "At temperature: ");
+    lcd_write(0, 1, bottomLine);
     sleep(3);
+#endif
 
     mysql_free_result(resOuter);
-    mysql_free_result(resInner);
 
 }
 
@@ -525,14 +595,14 @@ void coldest(MYSQL *conn){
     MYSQL_ROW row;
 
     double estColdest = 400.0; // 400.0 *C to set upper limit since not possible for day to day temperature
-    char estTime[10];
-    char day[20];
+    char estTime[10] = "";
+    char day[20] = "none";
 
     // query tables
-    if (mysql_query(conn, "show tables"))
+    if (mysql_query(conn, "show tables like 'day%'"))
     {
-        clear();
-        write(0, 0, "Error, exited");
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
         exit(1);
     }
     resOuter = mysql_store_result(conn);
@@ -546,21 +616,24 @@ void coldest(MYSQL *conn){
         ifDay[sizeof(ifDay)-1] = '\0';
 
         // query data from specific table
+        uint64_t started = metrics_now();
         char query[100];
         sprintf(query, "select * from %s", row[0]);
 
         if (mysql_query(conn, query)){
-            clear();
-            write(0, 0, "Error, exited");
+            lcd_clear();
+            lcd_write(0, 0, "Error, exited");
             exit(1);
         }
         resInner = mysql_store_result(conn);
 
         // sift through day's data and find coldest moment
         double coldest = 400.0;
-        char timeTemp[10];
+        char timeTemp[10] = "";
+        long rows = 0;
         while ((row = mysql_fetch_row(resInner)) != NULL){
             double temp = atof(row[1]);
+            rows++;
             if (temp < coldest){
                 coldest = temp;
                 strncpy(timeTemp, row[0], sizeof(timeTemp) - 1);
@@ -568,6 +641,9 @@ void coldest(MYSQL *conn){
             }
 
         }
+        mysql_free_result(resInner);
+        metrics_observe(HIST_QUERY_SCAN, started);
+        metrics_count(COUNT_QUERY_ROWS, rows);
 
         // replace values if there is new coldest
         if (coldest < estColdest){
@@ -577,26 +653,1093 @@ void coldest(MYSQL *conn){
             estTime[sizeof(estTime)-1] = '\0';
 
             strncpy(day, ifDay, sizeof(day) - 1);
+            day[sizeof(day)-1] = '\0';
         }
 
     }
 
+    // archived days keep their extremes in the archive index, no need to decompress them
+    struct archiveEntry entry;
+    FILE *index = openIndex("r");
+    while (index != NULL && readIndex(index, &entry)){
+        if (entry.minTemp < estColdest){
+            estColdest = entry.minTemp;
+
+            strncpy(estTime, entry.minTempTime, sizeof(estTime) - 1);
+            estTime[sizeof(estTime)-1] = '\0';
+
+            strncpy(day, entry.day, sizeof(day) - 1);
+            day[sizeof(day)-1] = '\0';
+        }
+    }
+    if (index != NULL)
+        fclose(index);
+
     // output results to LCD display
     char bottomLine[50];
-    sprintf(bottomLine, "%0.1fC (%s)", estColdest, estTime);
-
-    clear();
-    write(0, 0, "Coldest DB day: "); // DB - database, coldest day on database
-    write(0, 1, day);
+    sprintf(bottomLine, "%0.1fC (%.*s)", estColdest, TIME_SHOWN, estTime);
+
+    lcd_clear();
+    lcd_write(0, 0, "Coldest DB day: "); // DB - database, coldest day on database
+    lcd_write(0, 1, day);
+#if LCD_ROWS >= 4
+    lcd_write(0, 2, "At temperature: ");
+    lcd_write(0, 3, bottomLine);
+    sleep(6);
+#else
     sleep(3);
 
-    clear();
-    write(0, 0, "At temperature: ");
-    write(0, 1, bottomLine);
+    lcd_clear();
+    lcd_write(0, 0, "At temperature: ");
+    lcd_write(0, 1, bottomLine);
     sleep(3);
+#endif
 
     mysql_free_result(resOuter);
-    mysql_free_result(resInner);
 
 }
 
+
+
+// add one channel's histogram for a day ("all" for every day) and hour (-1 for every hour) into hist
+// read a number at a prompt, 0 if the input wasn't one; the bad token is dropped so the prompt can ask again
+int readInt(int *value){
+    int n = scanf("%d", value);
+    if (n == EOF){
+        lcd_clear();
+        lcd_write(0, 0, "Exited program");
+        exit(0);
+    }
+    if (n != 1)
+        scanf("%*s");
+    return n == 1;
+}
+
+int readDouble(double *value){
+    int n = scanf("%lf", value);
+    if (n == EOF){
+        lcd_clear();
+        lcd_write(0, 0, "Exited program");
+        exit(0);
+    }
+    if (n != 1)
+        scanf("%*s");
+    return n == 1;
+}
+
+void loadHistogram(MYSQL *conn, const char *day, int hour, char channel, struct histogram *hist){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    // build filter, summing in the database keeps transfer at O(bins) per channel
+    char filter[100];
+    int len = sprintf(filter, "channel = '%c'", channel);
+    if (strcmp(day, "all") != 0)
+        len += sprintf(filter + len, " and day = '%s'", day);
+    if (hour >= 0)
+        sprintf(filter + len, " and hour = %d", hour);
+
+    uint64_t started = metrics_now();
+    char query[200];
+    sprintf(query, "select bin, sum(count) from histograms where %s group by bin", filter);
+
+    if (mysql_query(conn, query))
+    {
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
+        exit(1);
+    }
+    res = mysql_store_result(conn);
+
+    while ((row = mysql_fetch_row(res)) != NULL){
+        int bin = atoi(row[0]);
+        long count = atol(row[1]);
+        if (bin < 0 || bin >= HIST_BINS)
+            continue;
+        hist->count[bin] += count;
+        hist->total += count;
+    }
+
+    mysql_free_result(res);
+    metrics_observe(HIST_QUERY_SCAN, started);
+
+}
+
+// choose a day + hour and load temperature and humidity histograms for it
+void chooseHistograms(MYSQL *conn, const char *prompt, struct histogram *temp, struct histogram *humi){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    // print out tables to choose from
+    scrollText(prompt);
+    if (mysql_query(conn, "show tables like 'day%'"))
+    {
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
+        exit(1);
+    }
+    res = mysql_store_result(conn);
+
+    while ((row = mysql_fetch_row(res)) != NULL){
+        char day[100];
+        sprintf(day, "%s", row[0]);
+        scrollText(day);
+    }
+    mysql_free_result(res);
+    scrollArchived();                                                // archived days keep their histograms
+    scrollText("or all");
+
+    // read selection + input validation, only day names reach SQL and the day must have histogram data
+    char selection[50];
+    struct tm date;
+    int hour;
+    while (1){
+
+        lcd_clear();
+        lcd_write(0, 0, "Choose a date:");
+        if (scanf("%49s", selection) != 1){
+            lcd_clear();
+            lcd_write(0, 0, "Exited program");
+            exit(0);
+        }
+        if (strcmp(selection, "all") != 0 && parseDay(selection, &date))
+        {
+            scrollText("Not a day, enter again");
+            continue;
+        }
+
+        lcd_clear();
+        lcd_write(0, 0, "Hour (-1 = all):");
+        if (!readInt(&hour))
+        {
+            scrollText("Hour must be a number, enter again");
+            continue;
+        }
+
+        memset(temp, 0, sizeof(*temp));
+        memset(humi, 0, sizeof(*humi));
+        loadHistogram(conn, selection, hour, 't', temp);
+        loadHistogram(conn, selection, hour, 'h', humi);
+
+        if (temp->total == 0)
+        {
+            scrollText("No readings for that day, enter again");
+            continue;
+        }
+
+        break;
+    }
+
+}
+
+// find median temperature + humidity from a specific day/hour
+void median(MYSQL *conn){
+
+    static struct histogram temp, humi;
+    chooseHistograms(conn, "Select day to find median from:", &temp, &humi);
+
+    // print out result to LCD display
+    char strHumi[20];
+    sprintf(strHumi, "H: %0.1f%%", histogramPercentile(&humi, 50.0));
+
+    char strTemp[20];
+    sprintf(strTemp, "T: %0.1fC", histogramPercentile(&temp, 50.0));
+
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
+
+    // pause program before going back to menu
+    sleep(3);
+
+}
+
+// find any percentile of temperature + humidity from a specific day/hour
+void percentile(MYSQL *conn){
+
+    static struct histogram temp, humi;
+
+    double p;
+    while (1){
+
+        lcd_clear();
+        lcd_write(0, 0, "Percentile:");
+        if (!readDouble(&p) || p < 0.0 || p > 100.0)
+        {
+            scrollText("Percentile must be 0 to 100, enter again");
+            continue;
+        }
+
+        break;
+    }
+
+    chooseHistograms(conn, "Select day to find percentile from:", &temp, &humi);
+
+    // print out result to LCD display
+    char strHumi[20];
+    sprintf(strHumi, "H: %0.1f%%", histogramPercentile(&humi, p));
+
+    char strTemp[20];
+    sprintf(strTemp, "T: %0.1fC", histogramPercentile(&temp, p));
+
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
+
+    // pause program before going back to menu
+    sleep(3);
+
+}
+
+// show spread of temperature + humidity (min, quartiles, max) from a specific day/hour
+void distribution(MYSQL *conn){
+
+    static struct histogram temp, humi;
+    chooseHistograms(conn, "Select day to find distribution from:", &temp, &humi);
+
+    const double points[] = {0.0, 10.0, 25.0, 50.0, 75.0, 90.0, 100.0};
+    const char *labels[] = {"min", "p10", "p25", "p50", "p75", "p90", "max"};
+    int n = sizeof(points) / sizeof(points[0]);
+
+    // one scrolling line per channel, 16 columns is too narrow for a table
+    char strTemp[200];
+    char strHumi[200];
+    int lenTemp = sprintf(strTemp, "Temp (%ld):", temp.total);
+    int lenHumi = sprintf(strHumi, "Humi (%ld):", humi.total);
+    for (int i = 0; i < n; i++){
+        lenTemp += sprintf(strTemp + lenTemp, " %s %0.1fC", labels[i], histogramPercentile(&temp, points[i]));
+        lenHumi += sprintf(strHumi + lenHumi, " %s %0.1f%%", labels[i], histogramPercentile(&humi, points[i]));
+    }
+
+    scrollText(strTemp);
+    scrollText(strHumi);
+
+}
+
+// seconds since start, for rows/sec reporting
+double elapsedSince(const struct timespec *start){
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+// load one dayMMDDYY.csv into its table with large multi-row inserts, streaming the file in chunks
+int importCsv(MYSQL *conn, const char *path){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // table name is the file name without directory or extension
+    char table[20];
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    int n = 0;
+    while (base[n] && base[n] != '.' && n < (int)sizeof(table) - 1){
+        table[n] = base[n];
+        n++;
+    }
+    table[n] = '\0';
+    // a real date, checked before anything is loaded: foldDay would refuse it after the rows were in
+    struct tm date;
+    if (parseDay(table, &date)){
+        fprintf(stderr, "%s: file name must be dayMMDDYY.csv with a valid date\n", path);
+        return 1;
+    }
+
+    // an archived day is already counted in histograms and cube, loading it again would count it twice
+    if (isArchived(table)){
+        fprintf(stderr, "%s: %s is already archived, skipping\n", path, table);
+        return 1;
+    }
+
+    FILE *in = fopen(path, "r");
+    if (in == NULL){
+        perror(path);
+        return 1;
+    }
+
+    char query[200];
+    if (day_table(conn, table) || reading_tables(conn)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        fclose(in);
+        return 1;
+    }
+
+    // refuse to load twice, keeps the day table and its histograms consistent
+    sprintf(query, "select count(*) from %s", table);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        fclose(in);
+        return 1;
+    }
+    res = mysql_store_result(conn);
+    row = mysql_fetch_row(res);
+    long existing = atol(row[0]);
+    mysql_free_result(res);
+    if (existing > 0){
+        fprintf(stderr, "%s: %s already has %ld rows, skipping\n", path, table, existing);
+        fclose(in);
+        return 1;
+    }
+
+    // validated rows are at most ~45 bytes, so a batch always fits inside the statement buffer
+    struct importBatch batch = { conn, NULL, IMPORT_BATCH * IMPORT_ROW_MAX + 100, 0, 0, 0, 0, 0 };
+    batch.sql = malloc(batch.size);
+    batch.prefix = batch.len = snprintf(batch.sql, batch.size, "insert into %s values ", table);
+
+    long skipped = 0;
+    int status = csvForEachLine(in, importRow, &batch, &skipped);
+    if (status < 0)
+        fprintf(stderr, "%s: line too long\n", path);
+    if (status == 0)
+        status = flushBatch(conn, batch.sql, &batch.len, batch.prefix, &batch.rows);
+    fclose(in);
+    free(batch.sql);
+
+    if (status)
+        return 1;
+
+    // histograms + cube for the day, built from the loaded rows in the database
+    if (foldDay(conn, table))
+        return 1;
+
+    double seconds = elapsedSince(&start);
+    fprintf(stderr, "%s: imported %ld rows (%ld skipped) into %s in %.3fs, %.0f rows/sec\n",
+        path, batch.total, skipped + batch.skipped, table, seconds, seconds > 0 ? batch.total / seconds : 0.0);
+    return 0;
+
+}
+
+// stream one day table to a CSV file (stdout if path is NULL) in the same format as the day*.csv files
+int exportCsv(MYSQL *conn, const char *table, const char *path){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (strncmp(table, "day", 3) != 0 || strspn(table + 3, "0123456789") != strlen(table + 3)){
+        fprintf(stderr, "%s: not a day table\n", table);
+        return 1;
+    }
+
+    char query[100];
+    sprintf(query, "select * from %s", table);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+
+    // use_result streams rows off the socket instead of holding the whole day in memory
+    res = mysql_use_result(conn);
+
+    // stdout gets its own stream on a duplicate descriptor, so its buffering is never touched
+    FILE *out;
+    if (path)
+        out = fopen(path, "w");
+    else {
+        fflush(stdout);
+        int fd = dup(STDOUT_FILENO);
+        out = fd >= 0 ? fdopen(fd, "w") : NULL;
+        if (out == NULL && fd >= 0)
+            close(fd);
+    }
+    if (out == NULL){
+        perror(path ? path : "stdout");
+        mysql_free_result(res);
+        return 1;
+    }
+    char *buffer = malloc(IO_CHUNK);
+    setvbuf(out, buffer, _IOFBF, IO_CHUNK);
+
+    // the seconds column only for rows that have it, older rows stay in the three column format
+    int columns = mysql_num_fields(res);
+    long rows = 0;
+    while ((row = mysql_fetch_row(res)) != NULL){
+        if (columns >= 4 && row[3] != NULL)
+            fprintf(out, "\"%s\",\"%s\",\"%s\",\"%s\"\n", row[0], row[1], row[2], row[3]);
+        else
+            fprintf(out, "\"%s\",\"%s\",\"%s\"\n", row[0], row[1], row[2]);
+        rows++;
+    }
+    mysql_free_result(res);
+
+    int failed = fclose(out) != 0;
+    free(buffer);
+    if (failed){
+        perror(path ? path : "stdout");
+        return 1;
+    }
+
+    double seconds = elapsedSince(&start);
+    fprintf(stderr, "%s: exported %ld rows in %.3fs, %.0f rows/sec\n",
+        table, rows, seconds, seconds > 0 ? rows / seconds : 0.0);
+    return 0;
+
+}
+
+// export every day table to <table>.csv in the current directory
+int exportAll(MYSQL *conn){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    if (mysql_query(conn, "show tables like 'day%'")){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    res = mysql_store_result(conn);
+
+    int status = 0;
+    while ((row = mysql_fetch_row(res)) != NULL){
+        char path[40];
+        snprintf(path, sizeof(path), "%s.csv", row[0]);
+        if (exportCsv(conn, row[0], path))
+            status = 1;
+    }
+
+    mysql_free_result(res);
+    return status;
+
+}
+
+// whole-archive report: per day table, global extremes and hour-of-day profiles from one pass over every day
+int report(MYSQL *conn, const char *path){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+    struct daySource src;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // days are listed up front (database, then archive), a streaming result has to be drained before the next query
+    if (mysql_query(conn, "show tables like 'day%'")){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    res = mysql_store_result(conn);
+
+    int listed = 0, capacity = 64;
+    char (*names)[20] = malloc(capacity * sizeof(*names));
+    while ((row = mysql_fetch_row(res)) != NULL){
+        if (listed == capacity)
+            names = realloc(names, (capacity *= 2) * sizeof(*names));
+        snprintf(names[listed++], sizeof(*names), "%s", row[0]);
+    }
+    mysql_free_result(res);
+
+    struct archiveEntry entry;
+    FILE *index = openIndex("r");
+    int hot = listed;
+    while (index != NULL && readIndex(index, &entry)){
+        int duplicate = 0;                                           // re-imported day, the table wins
+        for (int d = 0; d < hot && !duplicate; d++)
+            duplicate = strcmp(names[d], entry.day) == 0;
+        if (duplicate)
+            continue;
+        if (listed == capacity)
+            names = realloc(names, (capacity *= 2) * sizeof(*names));
+        snprintf(names[listed++], sizeof(*names), "%s", entry.day);
+    }
+    if (index != NULL)
+        fclose(index);
+
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if (out == NULL){
+        perror(path);
+        free(names);
+        return 1;
+    }
+
+    static struct periodStats hours[24];
+    memset(hours, 0, sizeof(hours));
+    struct periodStats hottest = {0}, coldest = {0};
+    char hottestDay[20] = "", coldestDay[20] = "";
+    long totalRows = 0;
+    int days = 0;
+
+    fprintf(out, "%-10s %6s %7s %16s %16s %7s %16s %16s %8s %8s\n", "day", "count", "avgT",
+        "minT (time)", "maxT (time)", "avgH", "minH (time)", "maxH (time)", "T>limit", "H>limit");
+
+    // outer loop through all the days
+    for (int d = 0; d < listed; d++){
+
+        char *day = names[d];
+        if (openDay(conn, day, 1, &src)){
+            fprintf(stderr, "%s: can't read day\n", day);
+            free(names);
+            if (path)
+                fclose(out);
+            return 1;
+        }
+
+        // sift through day's data once; a reading lasts its recorded interval, or on older days
+        // until the next one (up to REPORT_MAX_GAP)
+        struct periodStats stats = {0};
+        int lastMinute = -1;
+        double lastTemp = 0.0, lastHumi = 0.0;
+        while ((row = nextRow(&src)) != NULL){
+            double temp = atof(row[1]);
+            double humi = atof(row[2]);
+            double seconds = rowSeconds(&src, row);
+            int minute = minutesOf(row[0]);
+
+            if (src.columns >= 4 && row[3] != NULL){
+                if (temp > REPORT_TEMP_ABOVE)
+                    stats.minutesTempAbove += seconds / 60;
+                if (humi > REPORT_HUMI_ABOVE)
+                    stats.minutesHumiAbove += seconds / 60;
+            }
+            else if (lastMinute >= 0 && minute >= lastMinute && minute - lastMinute <= REPORT_MAX_GAP){
+                if (lastTemp > REPORT_TEMP_ABOVE)
+                    stats.minutesTempAbove += minute - lastMinute;
+                if (lastHumi > REPORT_HUMI_ABOVE)
+                    stats.minutesHumiAbove += minute - lastMinute;
+            }
+            lastMinute = minute;
+            lastTemp = temp;
+            lastHumi = humi;
+
+            addPeriod(&stats, temp, humi, seconds, row[0]);
+            if (minute >= 0)
+                addPeriod(&hours[minute / 60], temp, humi, seconds, row[0]);
+        }
+        closeDay(&src);
+
+        if (stats.count == 0)
+            continue;
+
+        char minT[20], maxT[20], minH[20], maxH[20];
+        sprintf(minT, "%0.1f (%s)", stats.temp.min, stats.temp.minTime);
+        sprintf(maxT, "%0.1f (%s)", stats.temp.max, stats.temp.maxTime);
+        sprintf(minH, "%0.1f (%s)", stats.humi.min, stats.humi.minTime);
+        sprintf(maxH, "%0.1f (%s)", stats.humi.max, stats.humi.maxTime);
+        fprintf(out, "%-10s %6ld %7.1f %16s %16s %7.1f %16s %16s %7.0fm %7.0fm\n", day, stats.count,
+            stats.temp.sum / stats.seconds, minT, maxT, stats.humi.sum / stats.seconds, minH, maxH,
+            stats.minutesTempAbove, stats.minutesHumiAbove);
+
+        // replace values if there is new hottest/coldest
+        if (days == 0 || stats.temp.max > hottest.temp.max){
+            hottest = stats;
+            strcpy(hottestDay, day);
+        }
+        if (days == 0 || stats.temp.min < coldest.temp.min){
+            coldest = stats;
+            strcpy(coldestDay, day);
+        }
+
+        totalRows += stats.count;
+        days++;
+    }
+    free(names);
+
+    if (days > 0){
+        fprintf(out, "\nHottest day: %s at %0.1fC (%s)\n", hottestDay, hottest.temp.max, hottest.temp.maxTime);
+        fprintf(out, "Coldest day: %s at %0.1fC (%s)\n", coldestDay, coldest.temp.min, coldest.temp.minTime);
+    }
+
+    // hour-of-day profile across every day
+    fprintf(out, "\n%-5s %8s %7s %7s %7s %7s %7s %7s\n", "hour", "count", "avgT", "minT", "maxT", "avgH", "minH", "maxH");
+    for (int h = 0; h < 24; h++){
+        if (hours[h].count == 0)
+            continue;
+        fprintf(out, "%02d:00 %8ld %7.1f %7.1f %7.1f %7.1f %7.1f %7.1f\n", h, hours[h].count,
+            hours[h].temp.sum / hours[h].seconds, hours[h].temp.min, hours[h].temp.max,
+            hours[h].humi.sum / hours[h].seconds, hours[h].humi.min, hours[h].humi.max);
+    }
+
+    if (path)
+        fclose(out);
+
+    double seconds = elapsedSince(&start);
+    fprintf(stderr, "report: %d days, %ld rows in %.3fs, %.0f rows/sec\n",
+        days, totalRows, seconds, seconds > 0 ? totalRows / seconds : 0.0);
+    return 0;
+
+}
+
+// add one day table's rows into the histograms and cube, grouped in the database
+int foldDay(MYSQL *conn, const char *table){
+
+    struct tm day;
+    if (parseDay(table, &day)){
+        fprintf(stderr, "%s: can't tell the date from the table name\n", table);
+        return 1;
+    }
+    if (upgrade_day(conn, table)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+
+    const char channels[2] = {'t', 'h'};
+    const char *columns[2] = {"temperature", "humidity"};
+    for (int c = 0; c < 2; c++){
+        char histogram[400];
+        sprintf(histogram, "insert into histograms select '%s', cast(substring_index(time, ':', 1) as unsigned), '%c', "
+            "least(greatest(round(%s * 10), 0), %d), count(*) from %s group by 2, 4 "
+            "on duplicate key update count = histograms.count + values(count)",
+            table, channels[c], columns[c], HIST_BINS - 1, table);
+        if (mysql_query(conn, histogram)){
+            fprintf(stderr, "%s\n", mysql_error(conn));
+            return 1;
+        }
+    }
+
+    char cube[1000];
+    sprintf(cube, "insert into cube select %d, %d, cast(substring_index(time, ':', 1) as unsigned), count(*), "
+        "sum(temperature * coalesce(seconds, %d)), min(temperature), max(temperature), "
+        "sum(humidity * coalesce(seconds, %d)), min(humidity), max(humidity), sum(coalesce(seconds, %d)) "
+        "from %s group by 3 "
+        "on duplicate key update count = cube.count + values(count), tempSum = cube.tempSum + values(tempSum), "
+        "tempMin = least(cube.tempMin, values(tempMin)), tempMax = greatest(cube.tempMax, values(tempMax)), "
+        "humiSum = cube.humiSum + values(humiSum), "
+        "humiMin = least(cube.humiMin, values(humiMin)), humiMax = greatest(cube.humiMax, values(humiMax)), "
+        "seconds = cube.seconds + values(seconds)",
+        day.tm_mon + 1, day.tm_wday, LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS, table);
+    if (mysql_query(conn, cube)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+
+    return 0;
+
+}
+
+// recompute histograms + cube from scratch, e.g. for days collected before they existed
+int rebuild(MYSQL *conn){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    if (reading_tables(conn) || mysql_query(conn, "delete from histograms") || mysql_query(conn, "delete from cube") ||
+        mysql_query(conn, "show tables like 'day%'")){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    res = mysql_store_result(conn);
+
+    int status = 0;
+    int days = 0;
+    while ((row = mysql_fetch_row(res)) != NULL){
+        if (foldDay(conn, row[0]))
+            status = 1;
+        else
+            days++;
+    }
+
+    // archived days were dropped from the database but still belong in histograms and cube
+    struct archiveEntry entry;
+    FILE *index = openIndex("r");
+    while (index != NULL && readIndex(index, &entry)){
+        int live = 0;                                                // re-imported day, the table was folded already
+        mysql_data_seek(res, 0);
+        while (!live && (row = mysql_fetch_row(res)) != NULL)
+            live = strcmp(row[0], entry.day) == 0;
+        if (live)
+            continue;
+        if (foldArchived(conn, entry.day))
+            status = 1;
+        else
+            days++;
+    }
+    if (index != NULL)
+        fclose(index);
+    mysql_free_result(res);
+
+    fprintf(stderr, "rebuild: %d days folded into histograms and cube\n", days);
+    return status;
+
+}
+
+// fold an archived day: its archive goes through a temporary table of the same name so foldDay does the grouping
+int foldArchived(MYSQL *conn, const char *day){
+
+    struct daySource src;
+    char **row;
+
+    if (openDay(conn, day, 0, &src) || src.gz == NULL){
+        fprintf(stderr, "%s: can't read archive\n", day);
+        if (src.res != NULL)
+            closeDay(&src);
+        return 1;
+    }
+
+    char query[200];
+    sprintf(query, "create temporary table %s " DAY_COLUMNS, day);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        closeDay(&src);
+        return 1;
+    }
+
+    struct importBatch batch = { conn, NULL, IMPORT_BATCH * IMPORT_ROW_MAX + 100, 0, 0, 0, 0, 0 };
+    batch.sql = malloc(batch.size);
+    batch.prefix = batch.len = snprintf(batch.sql, batch.size, "insert into %s values ", day);
+
+    int status = 0;
+    while (status == 0 && (row = nextRow(&src)) != NULL)
+        status = importRow(row, &batch);
+    if (status == 0)
+        status = flushBatch(conn, batch.sql, &batch.len, batch.prefix, &batch.rows);
+    closeDay(&src);
+    free(batch.sql);
+
+    if (status == 0)
+        status = foldDay(conn, day);
+
+    sprintf(query, "drop temporary table %s", day);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        status = 1;
+    }
+    return status;
+
+}
+
+// sum the cube cells matching where, at most 12 x 7 x 24 rows whatever the amount of history
+int cubeSummary(MYSQL *conn, const char *where, struct periodStats *stats){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    uint64_t started = metrics_now();
+    char query[300];
+    sprintf(query, "select sum(count), sum(tempSum), min(tempMin), max(tempMax), sum(humiSum), min(humiMin), max(humiMax), "
+        "sum(seconds) from cube where %s", where);
+    if (mysql_query(conn, query))
+    {
+        lcd_clear();
+        lcd_write(0, 0, "Error, exited");
+        exit(1);
+    }
+    res = mysql_store_result(conn);
+
+    memset(stats, 0, sizeof(*stats));
+    row = mysql_fetch_row(res);
+    if (row != NULL && row[0] != NULL){
+        stats->count = atol(row[0]);
+        stats->temp.sum = atof(row[1]);
+        stats->temp.min = atof(row[2]);
+        stats->temp.max = atof(row[3]);
+        stats->humi.sum = atof(row[4]);
+        stats->humi.min = atof(row[5]);
+        stats->humi.max = atof(row[6]);
+        stats->seconds = atof(row[7]);
+    }
+
+    mysql_free_result(res);
+    metrics_observe(HIST_QUERY_SCAN, started);
+    return stats->count > 0;
+
+}
+
+// typical values for a pattern: averages on the LCD, then the range scrolled (one screen on 4 rows)
+void showSummary(const char *label, const struct periodStats *stats){
+
+    if (stats->count == 0 || stats->seconds <= 0){
+        scrollText("No readings for that yet");
+        return;
+    }
+
+#if LCD_ROWS >= 4
+    char strTemp[40];
+    sprintf(strTemp, "T %0.1f %0.1f-%0.1fC", stats->temp.sum / stats->seconds, stats->temp.min, stats->temp.max);
+
+    char strHumi[40];
+    sprintf(strHumi, "H %0.1f %0.1f-%0.1f%%", stats->humi.sum / stats->seconds, stats->humi.min, stats->humi.max);
+
+    char strCount[40];
+    sprintf(strCount, "%ld readings", stats->count);
+
+    lcd_clear();
+    lcd_write(0, 0, label);
+    lcd_write(0, 1, strTemp);
+    lcd_write(0, 2, strHumi);
+    lcd_write(0, 3, strCount);
+    sleep(6);
+#else
+    char strHumi[20];
+    sprintf(strHumi, "H: %0.1f%%", stats->humi.sum / stats->seconds);
+
+    char strTemp[20];
+    sprintf(strTemp, "T: %0.1fC", stats->temp.sum / stats->seconds);
+
+    lcd_clear();
+    lcd_write(0, 0, strTemp);
+    lcd_write(0, 1, strHumi);
+    sleep(3);
+
+    char range[150];
+    sprintf(range, "%s: T %0.1f-%0.1fC, H %0.1f-%0.1f%%, %ld readings", label,
+        stats->temp.min, stats->temp.max, stats->humi.min, stats->humi.max, stats->count);
+    scrollText(range);
+#endif
+
+}
+
+// typical temperature + humidity at an hour of day, across all history
+void hourly(MYSQL *conn){
+
+    int hour;
+    while (1){
+
+        lcd_clear();
+        lcd_write(0, 0, "Hour (0-23):");
+        if (!readInt(&hour) || hour < 0 || hour > 23)
+        {
+            scrollText("Hour must be 0 to 23, enter again");
+            continue;
+        }
+
+        break;
+    }
+
+    char where[50];
+    sprintf(where, "hour = %d", hour);
+
+    char label[20];
+    sprintf(label, "%02d:00", hour);
+
+    struct periodStats stats;
+    cubeSummary(conn, where, &stats);
+    showSummary(label, &stats);
+
+}
+
+// weekdays against weekends, across all history
+void weekend(MYSQL *conn){
+
+    struct periodStats weekdays, weekends;
+    cubeSummary(conn, "dow between 1 and 5", &weekdays);
+    cubeSummary(conn, "dow in (0, 6)", &weekends);
+
+    showSummary("Weekdays", &weekdays);
+    showSummary("Weekends", &weekends);
+
+}
+
+// typical temperature + humidity in a month, across all years
+void monthly(MYSQL *conn){
+
+    int month;
+    while (1){
+
+        lcd_clear();
+        lcd_write(0, 0, "Month (1-12):");
+        if (!readInt(&month) || month < 1 || month > 12)
+        {
+            scrollText("Month must be 1 to 12, enter again");
+            continue;
+        }
+
+        break;
+    }
+
+    char where[50];
+    sprintf(where, "month = %d", month);
+
+    const char *names[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    struct periodStats stats;
+    cubeSummary(conn, where, &stats);
+    showSummary(names[month - 1], &stats);
+
+}
+
+// next entry of the archive index, 0 at end of file
+int readIndex(FILE *index, struct archiveEntry *entry){
+    char line[200];
+    while (fgets(line, sizeof(line), index) != NULL){
+        if (sscanf(line, "%19[^,],%ld,%lf,%9[^,],%lf,%9[^,\n]", entry->day, &entry->rows,
+                &entry->minTemp, entry->minTempTime, &entry->maxTemp, entry->maxTempTime) == 6)
+            return 1;
+    }
+    return 0;
+}
+
+// 1 if day is in the archive index
+int isArchived(const char *day){
+    struct archiveEntry entry;
+    int archived = 0;
+    FILE *index = openIndex("r");
+    while (index != NULL && !archived && readIndex(index, &entry))
+        archived = strcmp(entry.day, day) == 0;
+    if (index != NULL)
+        fclose(index);
+    return archived;
+}
+
+// list archived days on the LCD after the database tables
+void scrollArchived(void){
+    struct archiveEntry entry;
+    FILE *index = openIndex("r");
+    if (index == NULL)
+        return;
+    while (readIndex(index, &entry)){
+        char day[40];
+        sprintf(day, "%s (archived)", entry.day);
+        scrollText(day);
+    }
+    fclose(index);
+}
+
+// move one day table into archive/<day>.csv.gz + hourly rollups, then drop it
+int compactDay(MYSQL *conn, const char *table){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    if (upgrade_day(conn, table)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+
+    char query[800];
+    sprintf(query, "select * from %s", table);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    res = mysql_use_result(conn);
+
+    // write to a temporary name so a crash never leaves a half archive that looks complete
+    char path[300], tmp[300], name[40];
+    sprintf(name, "%s.csv.gz", table);
+    archivePath(path, sizeof(path), name);
+    sprintf(name, "%s.csv.gz.tmp", table);
+    archivePath(tmp, sizeof(tmp), name);
+    gzFile gz = gzopen(tmp, "wb9");
+    if (gz == NULL){
+        perror(tmp);
+        mysql_free_result(res);
+        return 1;
+    }
+    gzbuffer(gz, 1 << 16);
+
+    struct archiveEntry entry = {0};
+    strcpy(entry.day, table);
+    int failed = 0;
+    while ((row = mysql_fetch_row(res)) != NULL){
+        double temp = atof(row[1]);
+        if (entry.rows == 0 || temp < entry.minTemp){
+            entry.minTemp = temp;
+            snprintf(entry.minTempTime, sizeof(entry.minTempTime), "%s", row[0]);
+        }
+        if (entry.rows == 0 || temp > entry.maxTemp){
+            entry.maxTemp = temp;
+            snprintf(entry.maxTempTime, sizeof(entry.maxTempTime), "%s", row[0]);
+        }
+        int written = row[3] != NULL ?
+            gzprintf(gz, "\"%s\",\"%s\",\"%s\",\"%s\"\n", row[0], row[1], row[2], row[3]) :
+            gzprintf(gz, "\"%s\",\"%s\",\"%s\"\n", row[0], row[1], row[2]);
+        if (written <= 0)
+            failed = 1;
+        entry.rows++;
+    }
+    mysql_free_result(res);
+
+    if (gzclose(gz) != Z_OK || failed){
+        fprintf(stderr, "%s: writing archive failed\n", tmp);
+        remove(tmp);
+        return 1;
+    }
+
+    // empty days have nothing worth keeping
+    if (entry.rows == 0){
+        remove(tmp);
+    }
+    else {
+        if (rename(tmp, path)){
+            perror(path);
+            return 1;
+        }
+
+        // hourly rollups stay queryable in the database, time-weighted averages; histograms and cube are kept as they are.
+        // They go in before the index line: the upsert can run again, but an indexed day is never compacted again
+        sprintf(query, "insert into rollups select '%s', cast(substring_index(time, ':', 1) as unsigned), count(*), "
+            "sum(temperature * coalesce(seconds, %d)) / sum(coalesce(seconds, %d)), min(temperature), max(temperature), "
+            "sum(humidity * coalesce(seconds, %d)) / sum(coalesce(seconds, %d)), min(humidity), max(humidity), "
+            "sum(coalesce(seconds, %d)) from %s group by 2 on duplicate key update count = values(count), "
+            "tempAvg = values(tempAvg), tempMin = values(tempMin), tempMax = values(tempMax), "
+            "humiAvg = values(humiAvg), humiMin = values(humiMin), humiMax = values(humiMax), seconds = values(seconds)",
+            table, LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS, table);
+        if (mysql_query(conn, query)){
+            fprintf(stderr, "%s\n", mysql_error(conn));
+            return 1;
+        }
+
+        FILE *index = openIndex("a");
+        if (index == NULL){
+            perror(archivePath(path, sizeof(path), "index.csv"));
+            return 1;
+        }
+        fprintf(index, "%s,%ld,%0.1f,%s,%0.1f,%s\n", entry.day, entry.rows,
+            entry.minTemp, entry.minTempTime, entry.maxTemp, entry.maxTempTime);
+        if (fclose(index)){
+            perror(archivePath(path, sizeof(path), "index.csv"));
+            return 1;
+        }
+    }
+
+    sprintf(query, "drop table %s", table);
+    if (mysql_query(conn, query)){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+
+    fprintf(stderr, "%s: archived %ld rows\n", table, entry.rows);
+    return 0;
+
+}
+
+// compact every day table older than days, keeps the live database to the recent window
+int compact(MYSQL *conn, int days){
+
+    MYSQL_RES *res;
+    MYSQL_ROW row;
+
+    if (days < 1){
+        fprintf(stderr, "compact: age must be at least 1 day\n");
+        return 1;
+    }
+
+    if (mysql_query(conn, "create table if not exists rollups (day varchar(20), hour tinyint, count int, "
+            "tempAvg float, tempMin float, tempMax float, humiAvg float, humiMin float, humiMax float, seconds double, "
+            "primary key (day, hour))") ||
+        mysql_query(conn, "alter table rollups add column if not exists seconds double") ||
+        mysql_query(conn, "show tables like 'day%'")){
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    res = mysql_store_result(conn);
+
+    mkdir(archiveDir(), 0755);
+
+    // skip days already in the index, e.g. re-imported ones, so the index never has duplicates
+    time_t cutoff = time(NULL) - (time_t)days * 24 * 60 * 60;
+    int status = 0;
+    int compacted = 0;
+    while ((row = mysql_fetch_row(res)) != NULL){
+        struct tm date;
+        if (parseDay(row[0], &date) || mktime(&date) >= cutoff)
+            continue;
+
+        if (isArchived(row[0])){
+            fprintf(stderr, "%s: already archived, leaving table in place\n", row[0]);
+            continue;
+        }
+
+        if (compactDay(conn, row[0]))
+            status = 1;
+        else
+            compacted++;
+    }
+    mysql_free_result(res);
+
+    fprintf(stderr, "compact: %d days archived\n", compacted);
+    return status;
+
+}
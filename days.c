@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "days.h"
+#include "csv.h"
+#include "stats.h"
+#include "metrics.h"
+
+// date of a dayMMDDYY table, the collector writes days 1-9 unpadded (dayMMDYY)
+int parseDay(const char *table, struct tm *day){
+    int month, mday, year;
+    size_t digits = strlen(table + 3);
+    if (strncmp(table, "day", 3) != 0 || strspn(table + 3, "0123456789") != digits)
+        return 1;
+    if (digits == 6 && sscanf(table + 3, "%2d%2d%2d", &month, &mday, &year) != 3)
+        return 1;
+    if (digits == 5 && sscanf(table + 3, "%2d%1d%2d", &month, &mday, &year) != 3)
+        return 1;
+    if (digits != 5 && digits != 6)
+        return 1;
+
+    memset(day, 0, sizeof(*day));
+    day->tm_mon = month - 1;
+    day->tm_mday = mday;
+    day->tm_year = year + 100;
+    day->tm_hour = 12;                                               // away from DST edges
+    day->tm_isdst = -1;
+    if (mktime(day) == -1 || day->tm_mon != month - 1 || day->tm_mday != mday)
+        return 1;
+    return 0;
+}
+
+// send the pending multi-row insert, resetting the buffer to its "insert into ... values" prefix
+int flushBatch(MYSQL *conn, char *sql, int *len, int prefix, int *rows){
+    if (*rows == 0)
+        return 0;
+    if (mysql_real_query(conn, sql, *len - 1)){                      // drop trailing comma
+        fprintf(stderr, "%s\n", mysql_error(conn));
+        return 1;
+    }
+    *len = prefix;
+    *rows = 0;
+    return 0;
+}
+
+// validate one parsed row and append it to the pending insert, so nothing from the file reaches SQL unchecked
+int importRow(char *fields[], void *ctx){
+
+    struct importBatch *batch = ctx;
+    char *endTemp, *endHumi;
+
+    if (strlen(fields[0]) > 8 || strspn(fields[0], "0123456789:") != strlen(fields[0])){
+        batch->skipped++;
+        return 0;
+    }
+    double temp = strtod(fields[1], &endTemp);
+    double humi = strtod(fields[2], &endHumi);
+    if (endTemp == fields[1] || *endTemp != '\0' || !isfinite(temp) || temp < IMPORT_TEMP_MIN || temp > IMPORT_TEMP_MAX ||
+        endHumi == fields[2] || *endHumi != '\0' || !isfinite(humi) || humi < IMPORT_HUMI_MIN || humi > IMPORT_HUMI_MAX){
+        batch->skipped++;
+        return 0;
+    }
+
+    // files exported before the interval was recorded have three columns
+    long seconds = 0;
+    if (fields[3] != NULL){
+        char *endSeconds;
+        seconds = strtol(fields[3], &endSeconds, 10);
+        if (endSeconds == fields[3] || *endSeconds != '\0' || seconds < 1 || seconds > 24 * 60 * 60){
+            batch->skipped++;
+            return 0;
+        }
+    }
+
+    int room = batch->size - batch->len;
+    int n = seconds > 0 ?
+        snprintf(batch->sql + batch->len, room, "('%s',%.1f,%.1f,%ld),", fields[0], temp, humi, seconds) :
+        snprintf(batch->sql + batch->len, room, "('%s',%.1f,%.1f,null),", fields[0], temp, humi);
+    if (n < 0 || n >= room){
+        fprintf(stderr, "import: statement buffer full\n");
+        return 1;
+    }
+    batch->len += n;
+    batch->rows++;
+    batch->total++;
+
+    if (batch->rows == IMPORT_BATCH)
+        return flushBatch(batch->conn, batch->sql, &batch->len, batch->prefix, &batch->rows);
+    return 0;
+
+}
+
+const char *archiveDir(void){
+
+    static char dir[256];
+    if (dir[0] == '\0'){
+        const char *env = getenv("ARCHIVE_DIR");
+        const char *home = getenv("HOME");
+        if (env != NULL && env[0] != '\0')
+            snprintf(dir, sizeof(dir), "%s", env);
+        else if (home != NULL && home[0] != '\0')
+            snprintf(dir, sizeof(dir), "%s/" ARCHIVE_DIR, home);
+        else
+            snprintf(dir, sizeof(dir), ARCHIVE_DIR);
+    }
+    return dir;
+
+}
+
+char *archivePath(char *path, size_t size, const char *name){
+    snprintf(path, size, "%s/%s", archiveDir(), name);
+    return path;
+}
+
+FILE *openIndex(const char *mode){
+    char path[300];
+    return fopen(archivePath(path, sizeof(path), "index.csv"), mode);
+}
+
+// open a day for reading, stream picks mysql_use_result over store_result; 1 if the day is nowhere
+int openDay(MYSQL *conn, const char *day, int stream, struct daySource *src){
+
+    struct tm date;
+    memset(src, 0, sizeof(*src));
+    src->started = metrics_now();
+
+    // only day names reach SQL or the file system
+    if (parseDay(day, &date))
+        return 1;
+
+    char query[100];
+    sprintf(query, "select * from %s", day);
+    if (mysql_query(conn, query) == 0){
+        src->res = stream ? mysql_use_result(conn) : mysql_store_result(conn);
+        if (src->res == NULL)
+            return 1;
+        src->columns = mysql_num_fields(src->res);
+        return 0;
+    }
+
+    char path[300], name[40];
+    snprintf(name, sizeof(name), "%s.csv.gz", day);
+    return openDayFile(archivePath(path, sizeof(path), name), src);
+
+}
+
+// gzread passes files that aren't compressed through unchanged, so plain day*.csv files read the same way
+int openDayFile(const char *path, struct daySource *src){
+
+    memset(src, 0, sizeof(*src));
+    src->started = metrics_now();
+    src->gz = gzopen(path, "rb");
+    if (src->gz == NULL)
+        return 1;
+    gzbuffer(src->gz, 1 << 16);
+    return 0;
+
+}
+
+// next row of a day as time, temperature, humidity (, seconds) strings, NULL at the end
+char **nextRow(struct daySource *src){
+
+    if (src->res != NULL){
+        MYSQL_ROW row = mysql_fetch_row(src->res);
+        src->rows += row != NULL;
+        return row;
+    }
+
+    while (gzgets(src->gz, src->line, sizeof(src->line)) != NULL){
+        src->line[strcspn(src->line, "\r\n")] = '\0';
+        src->columns = parseCsvLine(src->line, src->fields, 4);
+        if (src->columns == 3)
+            src->fields[3] = NULL;
+        if (src->columns >= 3){
+            src->rows++;
+            return src->fields;
+        }
+    }
+    return NULL;
+
+}
+
+// how long a row stands for, LEGACY_SECONDS for rows from before the collector recorded it
+double rowSeconds(const struct daySource *src, char **row){
+    if (src->columns < 4 || row[3] == NULL || atof(row[3]) <= 0)
+        return LEGACY_SECONDS;
+    return atof(row[3]);
+}
+
+void closeDay(struct daySource *src){
+    metrics_observe(HIST_QUERY_SCAN, src->started);
+    metrics_count(COUNT_QUERY_ROWS, src->rows);
+    if (src->res != NULL)
+        mysql_free_result(src->res);
+    if (src->gz != NULL)
+        gzclose(src->gz);
+    memset(src, 0, sizeof(*src));
+}
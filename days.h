@@ -0,0 +1,75 @@
+#ifndef DAYS_H
+#define DAYS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <mysql/mysql.h>
+#include <zlib.h>
+
+#define ARCHIVE_DIR "archive"  // compressed day files + index.csv, under $HOME unless $ARCHIVE_DIR names the directory
+
+#define IMPORT_BATCH 5000       // rows per multi-row insert statement
+#define IMPORT_ROW_MAX 64       // bytes one validated row takes in the statement
+#define IMPORT_TEMP_MIN 0.0     // DHT11 range, anything outside it is skipped
+#define IMPORT_TEMP_MAX 60.0
+#define IMPORT_HUMI_MIN 0.0
+#define IMPORT_HUMI_MAX 100.0
+
+// pending multi-row insert while a file streams through csvForEachLine
+struct importBatch {
+    MYSQL *conn;
+    char *sql;
+    int size;
+    int len;
+    int prefix;             // length of "insert into ... values "
+    int rows;               // rows in the pending statement
+    long total;
+    long skipped;           // rows with a bad time, number or out of range value
+};
+
+// rows of one day, from its table if still in the database or else from its archive file
+struct daySource {
+    MYSQL_RES *res;
+    gzFile gz;
+    uint64_t started;       // for the query scan histogram
+    long rows;
+    int columns;            // 4 once the collector records each reading's interval, 3 before
+    char line[256];
+    char *fields[4];
+};
+
+// date of a dayMMDDYY table, the collector writes days 1-9 unpadded (dayMMDYY); 1 if it isn't a day name
+int parseDay(const char *table, struct tm *day);
+
+// send the pending multi-row insert, resetting the buffer to its "insert into ... values" prefix
+int flushBatch(MYSQL *conn, char *sql, int *len, int prefix, int *rows);
+
+// csvForEachLine callback (ctx is a struct importBatch): validate one row and append it to the pending insert,
+// sending it every IMPORT_BATCH rows
+int importRow(char *fields[], void *ctx);
+
+// the archive directory: $ARCHIVE_DIR, else ~/archive, so the menu and compact from cron see the same files
+const char *archiveDir(void);
+
+// name inside the archive directory, written to path
+char *archivePath(char *path, size_t size, const char *name);
+
+// the archive index opened with mode, NULL if there is none yet
+FILE *openIndex(const char *mode);
+
+// open a day for reading, stream picks mysql_use_result over store_result; 1 if the day is nowhere
+int openDay(MYSQL *conn, const char *day, int stream, struct daySource *src);
+
+// open a day*.csv file, compressed or not, as a day source; 1 if it can't be opened
+int openDayFile(const char *path, struct daySource *src);
+
+// next row of a day as time, temperature, humidity (, seconds) strings, NULL at the end
+char **nextRow(struct daySource *src);
+
+// how long a row stands for, LEGACY_SECONDS for rows from before the collector recorded it
+double rowSeconds(const struct daySource *src, char **row);
+
+void closeDay(struct daySource *src);
+
+#endif
@@ -0,0 +1,147 @@
+#define _GNU_SOURCE
+#include <wiringPi.h>     // wiringPi library
+#include <stdint.h>       // integer types
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <errno.h>
+#include <math.h>
+#include "dht11.h"
+
+// read values from the DHT11 sensor
+int dht11_read_raw(int val[5])
+{
+    uint8_t lststate = HIGH;
+    uint8_t counter = 0;
+    uint8_t j = 0, i;
+
+    // initialize the data array
+    for(i = 0; i < 5; i++)
+        val[i] = 0;
+
+    // send start signal to the DHT11 sensor
+    pinMode(DHT11PIN, OUTPUT);
+    digitalWrite(DHT11PIN, LOW);
+    delay(18);
+    digitalWrite(DHT11PIN, HIGH);
+    delayMicroseconds(40);
+
+    pinMode(DHT11PIN, INPUT);
+
+    for(i = 0; i < MAX_TIME; i++)
+    {
+        counter = 0;
+        while(digitalRead(DHT11PIN) == lststate) {
+            counter++;
+            delayMicroseconds(1);
+            if(counter == 255)
+                break;
+        }
+
+        lststate = digitalRead(DHT11PIN);
+
+        if(counter == 255)
+            break;
+
+        if((i >= 4) && (i % 2 == 0)) {
+            val[j / 8] <<= 1;
+            if(counter > 14)  // determining signal
+                val[j / 8] |= 1;
+            j++;
+        }
+    }
+
+    // verify checksum to ensure data integrity
+    return (j >= 40) && (val[4] == ((val[0] + val[1] + val[2] + val[3]) & 0xFF));
+}
+
+static long micros_between(const struct timespec *from, const struct timespec *to)
+{
+    return (to->tv_sec - from->tv_sec) * 1000000L + (to->tv_nsec - from->tv_nsec) / 1000;
+}
+
+int dht11_sample(int val[5], struct dht11_stats *stats, const struct timespec *deadline)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    if (deadline != NULL) {
+        long jitter = micros_between(deadline, &start);
+        if (jitter < 0)
+            jitter = 0;
+        stats->jitter_sum += jitter;
+        if (jitter > stats->jitter_max)
+            stats->jitter_max = jitter;
+    }
+
+    int ok = dht11_read_raw(val);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long took = micros_between(&start, &end);
+    if (took > stats->read_max)
+        stats->read_max = took;
+
+    stats->reads++;
+    if (!ok)
+        stats->failures++;
+    return ok;
+}
+
+void dht11_pace_init(struct dht11_pace *pace, int interval)
+{
+    interval = (interval + 500) / 1000 * 1000;
+    pace->interval = interval < PACE_MIN ? PACE_MIN : interval > PACE_MAX ? PACE_MAX : interval;
+    pace->primed = 0;
+}
+
+int dht11_pace_next(struct dht11_pace *pace, const int val[5], int ok)
+{
+    if (!ok)
+        return pace->interval;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double temp = val[2] + val[3] / 10.0;
+    double humi = val[0] + val[1] / 10.0;
+
+    if (pace->primed) {
+        double minutes = micros_between(&pace->at, &now) / 60e6;
+        double moved_temp = fabs(temp - pace->temp);
+        double moved_humi = fabs(humi - pace->humi);
+
+        if (minutes > 0 && (moved_temp / minutes > PACE_FAST_TEMP || moved_humi / minutes > PACE_FAST_HUMI))
+            pace->interval /= 4;
+        else if (moved_temp <= PACE_FLAT_TEMP && moved_humi <= PACE_FLAT_HUMI)
+            pace->interval *= 2;
+
+        // rows record whole seconds, so the interval stays on them too
+        pace->interval = (pace->interval + 500) / 1000 * 1000;
+        if (pace->interval < PACE_MIN)
+            pace->interval = PACE_MIN;
+        if (pace->interval > PACE_MAX)
+            pace->interval = PACE_MAX;
+    }
+
+    pace->primed = 1;
+    pace->temp = temp;
+    pace->humi = humi;
+    pace->at = now;
+    return pace->interval;
+}
+
+int dht11_realtime(int core)
+{
+    // lock current and future pages so the bit loop never takes a page fault
+    if (mlockall(MCL_CURRENT | MCL_FUTURE))
+        return errno;
+
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(core, &cpus);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (err)
+        return err;
+
+    struct sched_param param = { .sched_priority = RT_PRIORITY };
+    return pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+}
@@ -0,0 +1,50 @@
+#ifndef DHT11_H
+#define DHT11_H
+
+#include <time.h>
+
+#define MAX_TIME 85       // maximum time to wait for sensor response
+#define DHT11PIN 7        // GPIO pin number where DHT11 is connected
+#define RT_PRIORITY 80    // SCHED_FIFO priority of the sampling thread
+#define RT_CORE 3         // default core for the sampling thread, isolate it with isolcpus=3
+
+#define PACE_MIN 1000         // milliseconds, the DHT11 can't be read faster than once a second
+#define PACE_MAX 300000       // milliseconds, longest backoff while readings are flat
+#define PACE_FAST_TEMP 0.5    // C per minute, moving faster than this cuts the interval to a quarter
+#define PACE_FAST_HUMI 2.0    // % per minute
+#define PACE_FLAT_TEMP 0.5    // changes this small are flat and double the interval, the DHT11 steps 1 C / 1 %
+#define PACE_FLAT_HUMI 1.0
+
+// counters kept by the sampling loop, times in microseconds
+struct dht11_stats {
+    long reads;
+    long failures;        // checksum or short frame
+    long jitter_sum;      // wake-up lateness against the scheduled read time
+    long jitter_max;
+    long read_max;        // longest single read
+};
+
+// adaptive read interval, driven by the rate of change between good readings
+struct dht11_pace {
+    int interval;         // milliseconds until the next read, always whole seconds
+    int primed;           // a good reading has been seen
+    double temp;
+    double humi;
+    struct timespec at;   // when it was taken
+};
+
+// bit-bang one frame from the sensor into val, returns 1 if the checksum matches
+int dht11_read_raw(int val[5]);
+
+// timed read for the sampling loop, deadline is when the read was scheduled (NULL to skip jitter)
+int dht11_sample(int val[5], struct dht11_stats *stats, const struct timespec *deadline);
+
+void dht11_pace_init(struct dht11_pace *pace, int interval);
+
+// fold in a read and return the milliseconds until the next one; failed reads keep the interval
+int dht11_pace_next(struct dht11_pace *pace, const int val[5], int ok);
+
+// SCHED_FIFO + pin the calling thread to core, mlockall for the process; returns 0 or errno
+int dht11_realtime(int core);
+
+#endif
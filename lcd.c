@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "lcd.h"
+#include "metrics.h"
+
+#if LCD_ROWS != 2 && LCD_ROWS != 4
+#error "LCD_ROWS must be 2 or 4"
+#endif
+
+#ifdef LCD_TERMINAL
+
+// panel contents, redrawn at the top left of the terminal after every change;
+// drawn on stderr so export and report output on stdout stays clean
+static char screen[LCD_ROWS][LCD_COLS];
+
+static void draw(void){
+    char frame[(LCD_COLS + 3) * (LCD_ROWS + 2) + 16];
+    int len = sprintf(frame, "\0337\033[H+%.*s+\n", LCD_COLS, "--------------------");
+    for (int y = 0; y < LCD_ROWS; y++)
+        len += sprintf(frame + len, "|%.*s|\n", LCD_COLS, screen[y]);
+    len += sprintf(frame + len, "+%.*s+\0338", LCD_COLS, "--------------------");
+    fwrite(frame, 1, len, stderr);
+}
+
+void lcd_init(void){
+    lcd_clear();
+}
+
+void lcd_clear(void){
+    memset(screen, ' ', sizeof(screen));
+    draw();
+}
+
+void lcd_write(int x, int y, const char *text){
+    for (int i = 0; i < LCD_COLS - x && text[i] != '\0'; i++)
+        screen[y][x + i] = text[i];
+    draw();
+}
+
+#else
+
+#include <wiringPi.h>
+#include <wiringPiI2C.h>
+
+#define LCD_ADDR 0x27
+#define LCD_BACKLIGHT 0x08
+#define LCD_ENABLE 0x04
+#define LCD_DATA 0x01     // register select: character rather than command
+
+static int fd;
+
+// set-DDRAM-address command for the first column of each row; rows 2 and 3 continue rows 0 and 1
+static const unsigned char rowAddr[LCD_ROWS] = {
+    0x80, 0xC0,
+#if LCD_ROWS == 4
+    0x80 + LCD_COLS, 0xC0 + LCD_COLS,
+#endif
+};
+
+// one byte in 4-bit mode is four backpack writes: high nibble strobed, then low nibble strobed
+static inline void lcd_send(int byte, int mode){
+    int high = (byte & 0xF0) | LCD_BACKLIGHT | mode;
+    int low = ((byte << 4) & 0xF0) | LCD_BACKLIGHT | mode;
+    wiringPiI2CWrite(fd, high | LCD_ENABLE);
+    wiringPiI2CWrite(fd, high);
+    wiringPiI2CWrite(fd, low | LCD_ENABLE);
+    wiringPiI2CWrite(fd, low);
+}
+
+// clear and home need 1.52 ms; a character needs 37 us, less than the next I2C write takes
+static void send_command(int comm){
+    lcd_send(comm, 0);
+    delay(2);
+}
+
+void lcd_init(void){
+    fd = wiringPiI2CSetup(LCD_ADDR);
+    send_command(0x33);
+    delay(5);
+    send_command(0x32);
+    delay(5);
+    send_command(0x28);
+    delay(5);
+    send_command(0x0C);
+    delay(5);
+    send_command(0x01);
+    wiringPiI2CWrite(fd, LCD_BACKLIGHT);
+}
+
+// reset LCD display
+void lcd_clear(void){
+    send_command(0x01);
+}
+
+void lcd_write(int x, int y, const char *text){
+    send_command(rowAddr[y] + x);
+    for (int i = 0; i < LCD_COLS - x && text[i] != '\0'; i++)
+        lcd_send(text[i], LCD_DATA);
+}
+
+#endif
+
+// the window is always a full row, so frames overwrite each other instead of clearing
+void lcd_scroll(const char *message, int ms){
+    char window[LCD_COLS + 1];
+    int length = strlen(message);
+    struct timespec pause = { ms / 1000, (ms % 1000) * 1000000L };
+
+    lcd_clear();
+    for (int start = -LCD_COLS; start <= length; start++){          // message enters from the right and leaves on the left
+        for (int i = 0; i < LCD_COLS; i++){
+            int at = start + i;
+            window[i] = at >= 0 && at < length ? message[at] : ' ';
+        }
+        window[LCD_COLS] = '\0';
+
+        uint64_t started = metrics_now();
+        lcd_write(0, 0, window);
+        metrics_observe(HIST_LCD_FRAME, started);
+        metrics_count(COUNT_LCD_FRAMES, 1);
+        nanosleep(&pause, NULL);
+    }
+}
@@ -0,0 +1,25 @@
+#ifndef LCD_H
+#define LCD_H
+
+// HD44780 character panel, geometry and bus fixed at compile time so each build has one driver:
+//   (default)      16x2 on a PCF8574 I2C backpack, 4-bit mode
+//   -DLCD_20X4     20x4 on the same backpack
+//   -DLCD_TERMINAL draws the panel at the top of the terminal (on stderr) instead, for working without a Pi
+#ifdef LCD_20X4
+#define LCD_COLS 20
+#define LCD_ROWS 4
+#else
+#define LCD_COLS 16
+#define LCD_ROWS 2
+#endif
+
+void lcd_init(void);
+void lcd_clear(void);
+
+// x and y must be on the panel, text is cut at the end of the row
+void lcd_write(int x, int y, const char *text);
+
+// scroll a message of any length through the top row, ms between frames
+void lcd_scroll(const char *message, int ms);
+
+#endif
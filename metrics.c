@@ -0,0 +1,269 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "metrics.h"
+
+#define BUCKETS 105          // bucket 0 is <= 1.024 us, then 4 linear steps per power of two up to ~60 s, the last
+                             // one holds everything slower and only shows in +Inf
+#define FILE_PERIOD 10000    // milliseconds between stats file rewrites
+#define RENDER_SIZE (128 * 1024)
+#define CLIENT_TIMEOUT 1000  // milliseconds a scraper gets to send its request or take the reply
+
+const char *counter_names[COUNT_METRICS] = {
+    "sensor_reads_total",
+    "sensor_checksum_failures_total",
+    "db_inserts_total",
+    "lcd_frames_total",
+    "query_rows_total",
+};
+
+const char *hist_names[HIST_METRICS] = {
+    "sensor_read_seconds",
+    "db_insert_seconds",
+    "lcd_frame_seconds",
+    "query_scan_seconds",
+};
+
+// one per thread, only its owner writes so updates are plain relaxed load + store
+struct shard {
+    _Atomic long counts[COUNT_METRICS];
+    _Atomic uint64_t buckets[HIST_METRICS][BUCKETS];
+    _Atomic uint64_t sums[HIST_METRICS];
+    struct shard *next;
+};
+
+static int enabled;
+static const char *program_name = "sensor";
+static const char *stats_path;
+static int listen_fd = -1;
+static pthread_mutex_t shards_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct shard *shards;
+static _Thread_local struct shard *mine;
+
+// shards live until exit so a finished thread's counts are still exported
+static struct shard *my_shard(void)
+{
+    if (mine == NULL) {
+        mine = calloc(1, sizeof(*mine));
+        pthread_mutex_lock(&shards_lock);
+        mine->next = shards;
+        shards = mine;
+        pthread_mutex_unlock(&shards_lock);
+    }
+    return mine;
+}
+
+static void bump(_Atomic uint64_t *slot, uint64_t n)
+{
+    atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+// bucket b holds (bucket_limit(b - 1), bucket_limit(b)], matching the inclusive le of the exposition
+static int bucket_of(uint64_t ns)
+{
+    if (ns <= 1024)
+        return 0;
+    ns--;
+    int exp = 63 - __builtin_clzll(ns);
+    int index = 1 + (exp - 10) * 4 + (int)((ns >> (exp - 2)) & 3);
+    return index < BUCKETS ? index : BUCKETS - 1;
+}
+
+// inclusive upper bound of a bucket in nanoseconds
+static uint64_t bucket_limit(int index)
+{
+    if (index == 0)
+        return 1024;
+    int exp = 10 + (index - 1) / 4;
+    int step = (index - 1) % 4;
+    return (uint64_t)(4 + step + 1) << (exp - 2);
+}
+
+uint64_t metrics_now(void)
+{
+    if (!enabled)
+        return 0;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
+
+void metrics_count(enum metric_counter counter, long n)
+{
+    if (!enabled)
+        return;
+    _Atomic long *slot = &my_shard()->counts[counter];
+    atomic_store_explicit(slot, atomic_load_explicit(slot, memory_order_relaxed) + n, memory_order_relaxed);
+}
+
+void metrics_observe(enum metric_hist hist, uint64_t started)
+{
+    if (!enabled || started == 0)
+        return;
+    uint64_t took = metrics_now() - started;
+    struct shard *s = my_shard();
+    bump(&s->buckets[hist][bucket_of(took)], 1);
+    bump(&s->sums[hist], took);
+}
+
+// Prometheus text exposition of every shard summed, returns length
+static int render(char *out, int size)
+{
+    long counts[COUNT_METRICS] = {0};
+    uint64_t buckets[HIST_METRICS][BUCKETS] = {{0}};
+    uint64_t sums[HIST_METRICS] = {0};
+
+    pthread_mutex_lock(&shards_lock);
+    for (struct shard *s = shards; s != NULL; s = s->next) {
+        for (int c = 0; c < COUNT_METRICS; c++)
+            counts[c] += atomic_load_explicit(&s->counts[c], memory_order_relaxed);
+        for (int h = 0; h < HIST_METRICS; h++) {
+            sums[h] += atomic_load_explicit(&s->sums[h], memory_order_relaxed);
+            for (int b = 0; b < BUCKETS; b++)
+                buckets[h][b] += atomic_load_explicit(&s->buckets[h][b], memory_order_relaxed);
+        }
+    }
+    pthread_mutex_unlock(&shards_lock);
+
+    int len = 0;
+    for (int c = 0; c < COUNT_METRICS && len < size; c++)
+        len += snprintf(out + len, size - len, "# TYPE %s_%s counter\n%s_%s %ld\n",
+            program_name, counter_names[c], program_name, counter_names[c], counts[c]);
+
+    // every finite bucket on every scrape: rate() and histogram_quantile need the same le set each time
+    for (int h = 0; h < HIST_METRICS && len < size; h++) {
+        uint64_t total = 0;
+        len += snprintf(out + len, size - len, "# TYPE %s_%s histogram\n", program_name, hist_names[h]);
+        for (int b = 0; b < BUCKETS - 1 && len < size; b++) {
+            total += buckets[h][b];
+            len += snprintf(out + len, size - len, "%s_%s_bucket{le=\"%.9g\"} %llu\n", program_name, hist_names[h],
+                bucket_limit(b) / 1e9, (unsigned long long)total);
+        }
+        total += buckets[h][BUCKETS - 1];
+        if (len < size)
+            len += snprintf(out + len, size - len, "%s_%s_bucket{le=\"+Inf\"} %llu\n%s_%s_sum %.9f\n%s_%s_count %llu\n",
+                program_name, hist_names[h], (unsigned long long)total, program_name, hist_names[h], sums[h] / 1e9,
+                program_name, hist_names[h], (unsigned long long)total);
+    }
+    return len < size ? len : size - 1;
+}
+
+// rewrite the stats file through a temporary so readers never see half of it
+static void write_stats_file(void)
+{
+    static pthread_mutex_t file_lock = PTHREAD_MUTEX_INITIALIZER;
+    static char text[RENDER_SIZE];
+    char tmp[300];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", stats_path);
+
+    // the exporter and atexit can both get here
+    pthread_mutex_lock(&file_lock);
+    FILE *out = fopen(tmp, "w");
+    if (out != NULL) {
+        fwrite(text, 1, render(text, sizeof(text)), out);
+        if (fclose(out) == 0)
+            rename(tmp, stats_path);
+    }
+    pthread_mutex_unlock(&file_lock);
+}
+
+static void serve(int client)
+{
+    static char text[RENDER_SIZE];
+    char request[1024];
+    struct timeval timeout = { CLIENT_TIMEOUT / 1000, (CLIENT_TIMEOUT % 1000) * 1000 };
+    // a client that connects and stays silent would otherwise stall the stats file too
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    recv(client, request, sizeof(request), 0);                      // any path gets the metrics
+
+    int len = render(text, sizeof(text));
+    char header[200];
+    int header_len = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\n"
+        "Content-Type: text/plain; version=0.0.4\r\nContent-Length: %d\r\n\r\n", len);
+    send(client, header, header_len, MSG_NOSIGNAL);
+    for (int sent = 0, n; sent < len; sent += n)
+        if ((n = send(client, text + sent, len - sent, MSG_NOSIGNAL)) <= 0)
+            break;
+    close(client);
+}
+
+// exporter thread: answers scrapes and rewrites the stats file, never touches the hot paths
+static void *exporter(void *arg)
+{
+    (void)arg;
+    struct pollfd listener = { listen_fd, POLLIN, 0 };
+    uint64_t next_file = metrics_now();
+
+    while (1) {
+        int timeout = -1;
+        if (stats_path != NULL) {
+            uint64_t now = metrics_now();
+            if (now >= next_file) {
+                write_stats_file();
+                next_file = now + FILE_PERIOD * 1000000ULL;
+            }
+            timeout = (int)((next_file - now) / 1000000ULL) + 1;
+        }
+
+        if (listen_fd < 0) {
+            poll(NULL, 0, timeout);
+            continue;
+        }
+        if (poll(&listener, 1, timeout) > 0) {
+            int client = accept(listen_fd, NULL, NULL);
+            if (client >= 0)
+                serve(client);
+        }
+    }
+    return NULL;
+}
+
+void metrics_start(const char *program)
+{
+    const char *port = getenv("METRICS_PORT");
+    stats_path = getenv("METRICS_FILE");
+    if (port == NULL && stats_path == NULL)
+        return;
+
+    program_name = program;
+    enabled = 1;
+
+    // localhost only, there is no authentication
+    if (port != NULL) {
+        struct sockaddr_in addr = {0};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(port));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        int one = 1;
+
+        listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (listen_fd < 0 || setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) ||
+            bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, 8)) {
+            perror("metrics endpoint");
+            if (listen_fd >= 0)
+                close(listen_fd);
+            listen_fd = -1;
+        }
+    }
+
+    if (stats_path != NULL)
+        atexit(write_stats_file);
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_create(&thread, &attr, exporter, NULL);
+    pthread_attr_destroy(&attr);
+}
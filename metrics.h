@@ -0,0 +1,35 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+
+// counters, summed over every thread that touched them
+enum metric_counter {
+    COUNT_SENSOR_READS,
+    COUNT_CHECKSUM_FAILURES,
+    COUNT_INSERTS,
+    COUNT_LCD_FRAMES,
+    COUNT_QUERY_ROWS,
+    COUNT_METRICS
+};
+
+// latency histograms, nanoseconds in, seconds out
+enum metric_hist {
+    HIST_SENSOR_READ,
+    HIST_INSERT,
+    HIST_LCD_FRAME,
+    HIST_QUERY_SCAN,
+    HIST_METRICS
+};
+
+// starts the exporter when METRICS_PORT (Prometheus text on 127.0.0.1:port/metrics) and/or
+// METRICS_FILE (same text rewritten every 10 s and at exit) are set; otherwise recording is a no-op
+void metrics_start(const char *program);
+
+// monotonic nanoseconds, 0 when metrics are off so callers skip the clock read too
+uint64_t metrics_now(void);
+
+void metrics_count(enum metric_counter counter, long n);
+void metrics_observe(enum metric_hist hist, uint64_t started);   // started from metrics_now()
+
+#endif
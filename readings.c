@@ -0,0 +1,77 @@
+#include <stdio.h>
+#include <mysql/mysql.h>
+#include "readings.h"
+#include "stats.h"        // HIST_BINS, LEGACY_SECONDS
+
+int reading_tables(MYSQL *conn)
+{
+    // per day/hour histograms used for median and percentile queries
+    if (mysql_query(conn, "create table if not exists histograms (day varchar(20), hour tinyint, channel char(1), "
+        "bin smallint, count int, primary key (day, hour, channel, bin))"))
+        return 1;
+
+    // month (1-12) x day of week (0 = Sunday) x hour aggregates
+    if (mysql_query(conn, "create table if not exists cube (month tinyint, dow tinyint, hour tinyint, count int, "
+        "tempSum double, tempMin float, tempMax float, humiSum double, humiMin float, humiMax float, seconds double, "
+        "primary key (month, dow, hour))"))
+        return 1;
+
+    // cubes from before seconds were recorded: every reading stood for the old fixed interval
+    char legacy[300];
+    sprintf(legacy, "update cube set seconds = count * %d, tempSum = tempSum * %d, humiSum = humiSum * %d "
+        "where seconds is null", LEGACY_SECONDS, LEGACY_SECONDS, LEGACY_SECONDS);
+    return mysql_query(conn, "alter table cube add column if not exists seconds double") || mysql_query(conn, legacy);
+}
+
+int day_table(MYSQL *conn, const char *table)
+{
+    char query[200];
+    sprintf(query, "create table if not exists %s " DAY_COLUMNS, table);
+    return mysql_query(conn, query) || upgrade_day(conn, table);
+}
+
+int upgrade_day(MYSQL *conn, const char *table)
+{
+    char query[100];
+    sprintf(query, "alter table %s add column if not exists seconds int", table);
+    return mysql_query(conn, query) != 0;
+}
+
+int store_reading(MYSQL *conn, const char *table, const struct tm *when, const int val[5], int seconds)
+{
+    char strTemp[10];
+    sprintf(strTemp, "%d.%d", val[2], val[3]);
+
+    char strHumi[10];
+    sprintf(strHumi, "%d.%d", val[0], val[1]);
+
+    char strTime[10];
+    sprintf(strTime, "%02d:%02d:%02d", when->tm_hour, when->tm_min, when->tm_sec);
+
+    char insert[100];
+    sprintf(insert, "insert into %s values ('%s', %s, %s, %d)", table, strTime, strTemp, strHumi, seconds);
+
+    // histogram bins are the raw DHT11 integer + tenths, so no rounding is involved
+    int binTemp = val[2] * 10 + val[3];
+    int binHumi = val[0] * 10 + val[1];
+    if (binTemp >= HIST_BINS) binTemp = HIST_BINS - 1;
+    if (binHumi >= HIST_BINS) binHumi = HIST_BINS - 1;
+
+    char histogram[200];
+    sprintf(histogram, "insert into histograms values ('%s', %d, 't', %d, 1), ('%s', %d, 'h', %d, 1) "
+        "on duplicate key update count = count + 1",
+        table, when->tm_hour, binTemp, table, when->tm_hour, binHumi);
+
+    // one row per cube cell; sums are weighted by seconds
+    char cube[500];
+    sprintf(cube, "insert into cube values (%d, %d, %d, 1, %s * %d, %s, %s, %s * %d, %s, %s, %d) "
+        "on duplicate key update count = count + 1, tempSum = tempSum + values(tempSum), "
+        "tempMin = least(tempMin, values(tempMin)), tempMax = greatest(tempMax, values(tempMax)), "
+        "humiSum = humiSum + values(humiSum), "
+        "humiMin = least(humiMin, values(humiMin)), humiMax = greatest(humiMax, values(humiMax)), "
+        "seconds = seconds + values(seconds)",
+        when->tm_mon+1, when->tm_wday, when->tm_hour,
+        strTemp, seconds, strTemp, strTemp, strHumi, seconds, strHumi, strHumi, seconds);
+
+    return mysql_query(conn, insert) || mysql_query(conn, histogram) || mysql_query(conn, cube);
+}
@@ -0,0 +1,23 @@
+#ifndef READINGS_H
+#define READINGS_H
+
+#include <time.h>
+#include <mysql/mysql.h>
+
+// columns of a day table; the fourth, seconds, is NULL in rows from before the interval was recorded
+#define DAY_COLUMNS "(time varchar(50), temperature float, humidity float, seconds int)"
+
+// histograms and cube shared by all days, created if missing; cubes from before seconds were recorded are upgraded
+int reading_tables(MYSQL *conn);
+
+// create a day's table, or add the interval column to one from before it was recorded
+int day_table(MYSQL *conn, const char *table);
+
+// only the second half of day_table, for a table that must already exist
+int upgrade_day(MYSQL *conn, const char *table);
+
+// what the collector writes per reading: the row into table, its histogram bins and its cube cell.
+// val is a checked DHT11 frame taken at when, seconds how long it stands for. 1 on a MySQL error
+int store_reading(MYSQL *conn, const char *table, const struct tm *when, const int val[5], int seconds);
+
+#endif
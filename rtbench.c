@@ -0,0 +1,215 @@
+// DHT11 read failure rate under CPU/IO load, normal scheduling against real-time sampling.
+// Runs dht11.c unchanged against a simulated sensor, so no Pi is needed:
+//   gcc -O2 -o rtbench rtbench.c dht11.c -lpthread -lm && sudo ./rtbench [reads]
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <wiringPi.h>
+#include "dht11.h"
+
+#define SIM_LOOP_US 3     // one poll iteration on a Pi 4 (digitalRead + delayMicroseconds(1))
+#define SIM_INTERVAL 50   // milliseconds between reads, longer than the 18 ms start signal + frame
+#define READS 300         // default reads per mode
+
+// simulated sensor: the line level is a function of time since the host released it
+long edges[90];           // microseconds at which the level flips, starting high
+int edge_count;
+int edge_next;
+long poll_tick;           // when the current poll iteration ends
+struct timespec released;
+int expected[5];
+
+long now_micros(const struct timespec *since)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - since->tv_sec) * 1000000L + (now.tv_nsec - since->tv_nsec) / 1000;
+}
+
+// new random reading and its waveform: 20 high, 80 low, 80 high, per bit 50 low + 26/70 high, 50 low
+void sim_frame(void)
+{
+    expected[0] = 20 + rand() % 70;
+    expected[1] = 0;
+    expected[2] = rand() % 50;
+    expected[3] = rand() % 10;
+    expected[4] = (expected[0] + expected[1] + expected[2] + expected[3]) & 0xFF;
+
+    long t = 20;
+    edge_count = 0;
+    edges[edge_count++] = t;
+    edges[edge_count++] = t += 80;
+    edges[edge_count++] = t += 80;
+    for (int bit = 0; bit < 40; bit++) {
+        int one = (expected[bit / 8] >> (7 - bit % 8)) & 1;
+        edges[edge_count++] = t += 50;
+        edges[edge_count++] = t += one ? 70 : 26;
+    }
+    edges[edge_count++] = t += 50;
+}
+
+// wiringPi calls used by dht11_read_raw()
+void pinMode(int pin, int mode)
+{
+    (void)pin;
+    if (mode == INPUT) {
+        clock_gettime(CLOCK_MONOTONIC, &released);
+        edge_next = 0;
+        poll_tick = 0;
+    }
+}
+
+void digitalWrite(int pin, int value)
+{
+    (void)pin;
+    (void)value;
+}
+
+int digitalRead(int pin)
+{
+    (void)pin;
+    long t = now_micros(&released);
+    while (edge_next < edge_count && edges[edge_next] <= t)
+        edge_next++;
+    return edge_next % 2 == 0 ? HIGH : LOW;
+}
+
+void delay(unsigned int ms)
+{
+    struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+// paced from the previous poll so host timer overhead doesn't stretch the loop; a preempted
+// poll just resumes late, losing iterations the way it does on the Pi
+void delayMicroseconds(unsigned int us)
+{
+    long t = now_micros(&released);
+    if (t - poll_tick > (long)us * SIM_LOOP_US)
+        poll_tick = t;
+    poll_tick += (long)us * SIM_LOOP_US;
+    while (now_micros(&released) < poll_tick)
+        ;
+}
+
+// one benchmark mode, run on its own thread so real-time settings stay with it
+struct mode {
+    const char *name;
+    int realtime;
+    int reads;
+    int rt_error;
+    long mismatches;      // checksum passed but the values are wrong
+    struct dht11_stats stats;
+};
+
+void *run_mode(void *arg)
+{
+    struct mode *m = arg;
+    struct timespec next;
+    int val[5];
+
+    if (m->realtime)
+        m->rt_error = dht11_realtime(sysconf(_SC_NPROCESSORS_ONLN) - 1);   // last core, the one usually isolated
+
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    for (int i = 0; i < m->reads; i++) {
+        next.tv_nsec += SIM_INTERVAL * 1000000L;
+        if (next.tv_nsec >= 1000000000L) {
+            next.tv_sec++;
+            next.tv_nsec -= 1000000000L;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        sim_frame();
+        if (dht11_sample(val, &m->stats, &next) && memcmp(val, expected, sizeof(val)) != 0)
+            m->mismatches++;
+    }
+    return NULL;
+}
+
+void report(const struct mode *m)
+{
+    long bad = m->stats.failures + m->mismatches;
+    printf("%-16s %6ld %8ld %7.2f%% %10ld %10ld %10ld", m->name, m->stats.reads, bad,
+        100.0 * bad / m->stats.reads, m->stats.jitter_sum / m->stats.reads, m->stats.jitter_max, m->stats.read_max);
+    if (m->rt_error)
+        printf("  (real-time setup failed: %s)", strerror(m->rt_error));
+    printf("\n");
+}
+
+// CPU hogs on every core plus one process doing write + fsync, all at normal priority
+int start_load(pid_t *children)
+{
+    int n = 0;
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    for (long c = 0; c < cpus && n < 255; c++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            volatile unsigned long x = 0;
+            while (1)
+                x = x * 1103515245 + 12345;
+        }
+        children[n++] = pid;
+    }
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        char path[] = "/tmp/rtbenchXXXXXX";
+        int fd = mkstemp(path);
+        unlink(path);
+        static char block[1 << 20];
+        memset(block, 'x', sizeof(block));
+        while (1) {
+            if (write(fd, block, sizeof(block)) < 0 || fsync(fd) || lseek(fd, 0, SEEK_SET) < 0)
+                sleep(1);
+        }
+    }
+    children[n++] = pid;
+    return n;
+}
+
+void stop_load(pid_t *children, int n)
+{
+    for (int i = 0; i < n; i++)
+        kill(children[i], SIGKILL);
+    for (int i = 0; i < n; i++)
+        waitpid(children[i], NULL, 0);
+}
+
+int main(int argc, char *argv[])
+{
+    int reads = argc >= 2 ? atoi(argv[1]) : READS;
+    if (reads < 1)
+        reads = READS;
+    srand(time(NULL));
+
+    struct mode modes[] = {
+        { "idle",        0, reads, 0, 0, {0} },
+        { "loaded",      0, reads, 0, 0, {0} },
+        { "loaded + rt", 1, reads, 0, 0, {0} },
+    };
+    int count = sizeof(modes) / sizeof(modes[0]);
+
+    pid_t children[256];
+    int loaders = 0;
+
+    printf("%-16s %6s %8s %8s %10s %10s %10s\n", "mode", "reads", "failed", "rate", "jitter avg", "jitter max", "read max");
+    for (int i = 0; i < count; i++) {
+        if (i == 1)
+            loaders = start_load(children);
+
+        pthread_t thread;
+        pthread_create(&thread, NULL, run_mode, &modes[i]);
+        pthread_join(thread, NULL);
+        report(&modes[i]);
+    }
+    stop_load(children, loaders);
+
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <string.h>
+#include "stats.h"
+
+// value at the p-th percentile (0 - 100), walks the cumulative counts once
+double histogramPercentile(const struct histogram *hist, double p){
+
+    if (hist->total == 0)
+        return 0.0;
+
+    // nearest-rank method, rank is 1-based
+    long rank = (long)(p / 100.0 * hist->total + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > hist->total)
+        rank = hist->total;
+
+    long seen = 0;
+    for (int bin = 0; bin < HIST_BINS; bin++){
+        seen += hist->count[bin];
+        if (seen >= rank)
+            return bin / 10.0;
+    }
+
+    return (HIST_BINS - 1) / 10.0;
+
+}
+
+// fold one reading into a channel's running stats
+void addReading(struct channelStats *stats, long count, double value, double seconds, const char *when){
+    stats->sum += value * seconds;
+    if (count == 0 || value < stats->min){
+        stats->min = value;
+        strncpy(stats->minTime, when, sizeof(stats->minTime) - 1);
+        stats->minTime[sizeof(stats->minTime)-1] = '\0';
+    }
+    if (count == 0 || value > stats->max){
+        stats->max = value;
+        strncpy(stats->maxTime, when, sizeof(stats->maxTime) - 1);
+        stats->maxTime[sizeof(stats->maxTime)-1] = '\0';
+    }
+}
+
+// fold one reading into a day or hour, count is bumped after both channels
+void addPeriod(struct periodStats *stats, double temp, double humi, double seconds, const char *when){
+    addReading(&stats->temp, stats->count, temp, seconds, when);
+    addReading(&stats->humi, stats->count, humi, seconds, when);
+    stats->count++;
+    stats->seconds += seconds;
+}
+
+// "HH:MM" or "HH:MM:SS" to minutes since midnight, -1 if unparseable
+int minutesOf(const char *when){
+    int hour, minute;
+    if (sscanf(when, "%d:%d", &hour, &minute) != 2 || hour < 0 || hour > 23 || minute < 0 || minute > 59)
+        return -1;
+    return hour * 60 + minute;
+}
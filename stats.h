@@ -0,0 +1,38 @@
+#ifndef STATS_H
+#define STATS_H
+
+#define HIST_BINS 1001  // histogram bins, 0.0 to 100.0 in DHT11 tenths
+#define LEGACY_SECONDS 30  // rows from before the collector recorded its interval stand for the old fixed 30 s
+
+// fixed-bin histogram of one channel, merged across any number of days/hours
+struct histogram {
+    long count[HIST_BINS];
+    long total;
+};
+
+double histogramPercentile(const struct histogram *hist, double p);
+
+// running sum/min/max of one channel, the sum weighted by seconds
+struct channelStats {
+    double sum;
+    double min;
+    double max;
+    char minTime[10];
+    char maxTime[10];
+};
+
+// everything the report keeps per day or per hour of day
+struct periodStats {
+    long count;
+    double seconds;         // time the readings stand for, averages are sum / seconds
+    struct channelStats temp;
+    struct channelStats humi;
+    double minutesTempAbove;
+    double minutesHumiAbove;
+};
+
+void addReading(struct channelStats *stats, long count, double value, double seconds, const char *when);
+void addPeriod(struct periodStats *stats, double temp, double humi, double seconds, const char *when);
+int minutesOf(const char *when);
+
+#endif